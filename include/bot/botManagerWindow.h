@@ -8,8 +8,11 @@
 
 // Internal dependencies
 #include <system/mouseMovement.h>
+#include <system/framePool.h>
+#include <system/sessionRecorder.h>
 #include <ml/onnxruntimeInference.h>
 #include <bot/ibotWindow.h>
+#include <bot/taskScheduler.h>
 
 struct DetectionBoxState
 {
@@ -36,11 +39,18 @@ private:
 
 	// Tasks
 	std::vector<class IBotTask*> _tasks;
+	TaskScheduler _taskScheduler;
 
+	FrameHandle _frameHandle;
 	cv::Mat _frame;
+	// Scratch frame the tasks draw on while the bot runs (published frames are read-only)
+	cv::Mat _drawFrame;
 	uint32_t _frameTexId;
+	float _pendingDeltaTime = 0.0f;
 
 	bool _isBotRunning = false;
+	int _fullFrameRate = 0;
+	SessionRecorder _sessionRecorder;
 
 	// TODO: move this to a task
 	std::vector<DetectionBox> _detections;
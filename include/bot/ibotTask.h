@@ -4,6 +4,8 @@
 #include <vector>
 #include <string>
 
+class InputSignature;
+
 class IBotTask
 {
 public:
@@ -18,6 +20,12 @@ public:
 	virtual void GetNextTask(IBotTask*& nextTask) { nextTask = _nextTask; };
 	virtual void SetNextTask(IBotTask* nextTask) { _nextTask = nextTask; };
 
+	// Adds everything the next Run would read (input areas, settings) to the signature, the TaskScheduler skips Run
+	// while it stays the same. Tasks that can't tell (or have pending work) return false and always run.
+	virtual bool GetInputSignature(InputSignature& signature) { return false; };
+	// Called instead of Run when the inputs didn't change, publishes the outputs of the last Run again
+	virtual void Republish(float deltaTime) { };
+
 private:
 	// Next task in the chain
 	IBotTask* _nextTask = nullptr;
@@ -0,0 +1,100 @@
+#pragma once
+
+// Std dependencies
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// Third party dependencies
+#include <opencv2/core.hpp>
+
+// Internal dependencies
+#include <system/framePool.h>
+#include <bot/ibotTask.h>
+
+// Accumulates what a task reads into a single value, equal signatures meaning the task would compute the same outputs
+class InputSignature
+{
+public:
+	void Add(uint64_t value) { _hash = (_hash ^ value) * 1099511628211ull; }
+	void Add(int value) { Add((uint64_t)(int64_t)value); }
+	void Add(bool value) { Add((uint64_t)value); }
+	void Add(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		Add((uint64_t)bits);
+	}
+	void Add(const cv::Rect& rect)
+	{
+		Add(rect.x);
+		Add(rect.y);
+		Add(rect.width);
+		Add(rect.height);
+	}
+
+	// Diffs the rect through the change stamps of the frame (no pixel is read), hashing its pixels when changes aren't tracked
+	void AddRegion(const Frame& frame, const cv::Rect& rect);
+	// Hashes the pixels of the image
+	void AddImage(const cv::Mat& image);
+
+	uint64_t Get() const { return _hash; }
+
+private:
+	uint64_t _hash = 14695981039346656037ull;
+};
+
+struct TaskRunStats
+{
+	size_t executedCount = 0;
+	size_t skippedCount = 0;
+	// Milliseconds spent in Run, and in computing signatures and republishing
+	double executedTime = 0.0;
+	double overheadTime = 0.0;
+
+	double GetAverageRunTime() const { return executedCount > 0 ? executedTime / executedCount : 0.0; }
+	float GetSkipRatio() const { return executedCount + skippedCount > 0 ? (float)skippedCount / (executedCount + skippedCount) : 0.0f; }
+	// Skipped runs at the average run time, minus what gating cost
+	double GetSavedTime() const { return skippedCount * GetAverageRunTime() - overheadTime; }
+
+	void Accumulate(const TaskRunStats& other)
+	{
+		executedCount += other.executedCount;
+		skippedCount += other.skippedCount;
+		executedTime += other.executedTime;
+		overheadTime += other.overheadTime;
+	}
+};
+
+// Runs the task chain for a frame, skipping the tasks whose inputs didn't change since their last run
+// (motion gating), those republish their previous outputs instead
+class TaskScheduler
+{
+public:
+	TaskScheduler() = default;
+	~TaskScheduler() = default;
+
+	void Run(const std::vector<IBotTask*>& tasks, float deltaTime);
+
+	void SetMotionGating(bool enabled) { _motionGating = enabled; }
+	bool IsMotionGating() const { return _motionGating; }
+
+	// Next run of every task goes through Run (e.g. after the tasks were loaded again)
+	void Invalidate();
+
+	TaskRunStats GetStats(IBotTask* task) const;
+	TaskRunStats GetTotalStats() const;
+	void ResetStats();
+
+private:
+	struct TaskState
+	{
+		uint64_t signature = 0;
+		bool hasSignature = false;
+		TaskRunStats stats;
+	};
+
+	bool _motionGating = true;
+	std::unordered_map<IBotTask*, TaskState> _states;
+};
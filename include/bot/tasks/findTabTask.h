@@ -1,10 +1,16 @@
 #pragma once
 
+// Std dependencies
+#include <string>
+
 // Third party dependencies
 #include <opencv2/core.hpp>
 
 // Internal dependencies
 #include <ml/onnxruntimeInference.h>
+#include <ml/inferenceExecutor.h>
+#include <ml/detectionPostProcess.h>
+#include <system/framePool.h>
 #include <bot/ibotTask.h>
 
 enum TabClasses
@@ -21,6 +27,9 @@ enum TabClasses
 
 static const char* TabNames[] = { "Attack Style Tab", "Friends List Tab", "Inventory Tab", "Magic Tab", "Prayer Tab", "Quests Tab", "Skills Tab", "Equipments Tab" };
 
+// Resource holding the FrameRegion a tab frame was cropped from
+inline std::string getTabRegionResource(TabClasses tab) { return std::string(TabNames[tab]) + " Region"; }
+
 class FindTabTask : public IBotTask
 {
 public:
@@ -29,6 +38,22 @@ public:
 	virtual bool Load() override;
 	virtual void Run(float deltaTime) override;
 	virtual void Draw() override;
+	virtual bool GetInputSignature(InputSignature& signature) override;
+	virtual void Republish(float deltaTime) override;
+
+	void SetModelPath(const std::wstring& modelPath);
+	// Runs the model on the inference executor instead of blocking Run (results are picked up by a later Run)
+	void SetAsyncInference(bool asyncInference) { _asyncInference = asyncInference; }
+	// Execution provider of the model (CPU only machines use the CPU either way), applied by the next Load
+	void SetUseCuda(bool useCuda) { _useCuda = useCuda; }
+	// Verifies the tabs found by the model against templates of them, the model only runs again when
+	// a tab isn't found around its last position or the refresh interval elapsed (detect-then-track)
+	void SetTemplateTracking(bool templateTracking) { _templateTracking = templateTracking; }
+	// Runs the model over native resolution tiles of the frame instead of a single downscaled view (see TiledDetector)
+	void SetTiling(bool enabled, const TilingConfig& config = TilingConfig());
+
+	size_t GetTrackedCount() const { return _trackedCount; }
+	size_t GetDetectionCount() const { return _detectionCount; }
 
 	virtual const char* GetName() override { return "Find Tab Task"; }
 	virtual void GetInputResources(std::vector<std::string>& resources) override { }
@@ -38,16 +63,49 @@ public:
 	cv::Mat GetTabFrame() { return _tabFrame.clone(); }
 
 private:
+	// Draws the detections on the frame and sets the tab frame resources
+	void publish(cv::Mat& frame, FrameHandle* frameHandle);
+	// Keeps grayscale templates of the detected tabs (none when any of them can't be taken)
+	void updateTemplates(const Frame& frame, uint64_t detectionSequence);
+	// Matches every template in a window around its tab, moving the tabs when all of them are found
+	bool verifyTemplates(const Frame& frame);
+
 	// Internal state
-	class PreProcessBoxDetectionBase* _model;
+	class PreProcessBoxDetectionBase* _model = nullptr;
+	// Path the current model was loaded from, restarts keep the model while it didn't change
+	std::wstring _loadedModelPath;
+	bool _loadedUseCuda = false;
 	std::vector<DetectionBox> _detectedTabs;
+	DetectionPostProcessor _postProcessor;
 	bool _exportDetection = false;
 	bool _shouldOverrideClass = false;
 	TabClasses _overrideClass = TAB_INVENTORY;
+	int _tabSubscription = -1;
+	uint64_t _inferenceSequence = 0;
+	float _inferenceConfidenceThreshold = -1.0f;
+	InferenceExecutor _executor;
+	InferenceResult _inferenceResult;
+	std::vector<cv::Mat> _tabTemplates;
+	std::vector<cv::Point> _trackedPositions;
+	cv::Mat _searchWindow;
+	cv::Mat _matchScores;
+	float _timeSinceDetection = 0.0f;
+	size_t _trackedCount = 0;
+	size_t _detectionCount = 0;
+	double _lastTrackingTime = 0.0;
 
 	// Public state
 	wchar_t* _modelPath = nullptr;
+	bool _useCuda = true;
+	bool _asyncInference = true;
 	float _confidenceThreshold = 0.935f;
 	TabClasses _trackingTab = TAB_INVENTORY;
+	bool _templateTracking = true;
+	bool _tiledInference = false;
+	TilingConfig _tilingConfig;
+	float _trackingRefreshInterval = 5.0f;
+	float _trackingMinScore = 0.9f;
+	int _trackingSearchMargin = 8;
 	cv::Mat _tabFrame;
+	FrameRegion _tabRegion;
 };
\ No newline at end of file
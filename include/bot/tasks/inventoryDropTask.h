@@ -5,6 +5,8 @@
 
 // Internal dependencies
 #include <ml/onnxruntimeInference.h>
+#include <ml/inferenceExecutor.h>
+#include <ml/detectionPostProcess.h>
 #include <bot/ibotTask.h>
 
 enum OreItems
@@ -58,17 +60,42 @@ public:
 	virtual bool Load() override;
 	virtual void Run(float deltaTime) override;
 	virtual void Draw() override;
+	virtual bool GetInputSignature(InputSignature& signature) override;
+	virtual void Republish(float deltaTime) override;
+
+	void SetModelPath(const std::wstring& modelPath);
+	// Runs the model on the inference executor instead of blocking Run (results are picked up by a later Run)
+	void SetAsyncInference(bool asyncInference) { _asyncInference = asyncInference; }
+	// Execution provider of the model (CPU only machines use the CPU either way), applied by the next Load
+	void SetUseCuda(bool useCuda) { _useCuda = useCuda; }
+	// Shows the tab frame with its detections in a HighGUI window (headless runs must turn it off)
+	void SetShowTabWindow(bool showTabWindow) { _showTabWindow = showTabWindow; }
 
 	virtual const char* GetName() override { return "Inventory Drop Task"; }
 	virtual void GetInputResources(std::vector<std::string>& resources) override;
 	virtual void GetOutputResources(std::vector<std::string>& resources) override { };
 
 private:
+	// Draws the detected items on the tab frame (and shows it when enabled)
+	void publish(cv::Mat& tabFrame);
+
 	// Internal state
-	class YOLOv8* _model;
+	class YOLOv8* _model = nullptr;
+	// Path the current model was loaded from, restarts keep the model while it didn't change
+	std::wstring _loadedModelPath;
+	bool _loadedUseCuda = false;
 	std::vector<DetectionBox> _detectedItems;
+	DetectionPostProcessor _postProcessor;
+	uint64_t _inferenceSequence = 0;
+	cv::Rect _inferenceRect;
+	float _inferenceConfidenceThreshold = -1.0f;
+	InferenceExecutor _executor;
+	InferenceResult _inferenceResult;
 
 	// Public state
 	wchar_t* _modelPath = nullptr;
+	bool _useCuda = true;
+	bool _asyncInference = true;
+	bool _showTabWindow = true;
 	float _confidenceThreshold = 0.935f;
 };
\ No newline at end of file
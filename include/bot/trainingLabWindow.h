@@ -9,6 +9,7 @@
 // Internal dependencies
 #include <bot/ibotWindow.h>
 #include <system/mouseMovement.h>
+#include <system/framePool.h>
 
 class TrainingLabWindow : public IBotWindow
 {
@@ -25,6 +26,7 @@ class TrainingLabWindow : public IBotWindow
 	class InputManager& _inputManager;
 
 	// Internal state
+	FrameHandle _frameHandle;
 	cv::Mat _frame;
 	uint32_t _frameTexId;
 
@@ -0,0 +1,66 @@
+#pragma once
+
+// Std dependencies
+#include <utility>
+#include <vector>
+
+// Third party dependencies
+#include <opencv2/core.hpp>
+
+// Internal dependencies
+#include <ml/detectionBox.h>
+
+// Box geometry of a YOLO style head, center and size in input pixels or relative to the input size
+enum BoxEncoding
+{
+	BOX_CXCYWH_PIXELS = 0,
+	BOX_CXCYWH_NORMALIZED = 1
+};
+
+static const char* BoxEncodingNames[] = { "cxcywh pixels", "cxcywh normalized" };
+
+// Memory layout of a YOLO style head output
+enum OutputLayout
+{
+	// [4 + classes, predictions], one plane per feature (what YOLOv8 exports)
+	LAYOUT_CHANNEL_MAJOR = 0,
+	// [predictions, 4 + classes], one row per prediction (transposed exports)
+	LAYOUT_PREDICTION_MAJOR = 1
+};
+
+static const char* OutputLayoutNames[] = { "channel major", "prediction major" };
+
+// Decoder of a YOLO style head, featureCount being the 4 + classes of the head (the row stride of prediction major outputs)
+// and classCount the classes actually decoded (the first ones)
+using YOLOv8DecodeFunction = void (*)(const float* output, int predictionCount, int featureCount, int classCount, float confidenceThreshold,
+									  const cv::Size& inputSize, const cv::Vec2f& inputScale, const cv::Vec2f& inputPadding,
+									  std::vector<DetectionBox>& detections);
+
+// Picks the decoder compiled for the class count, box encoding and layout of a head. The class count of our heads (8 for the
+// tab models, 18 for the inventory one) is a template argument of their decoders, so the loops over classes have a constant
+// trip count and get unrolled and vectorized. Other class counts get a generic decoder (the class count read at runtime).
+YOLOv8DecodeFunction selectYOLOv8Decoder(int classCount, BoxEncoding encoding, OutputLayout layout, bool* specialized = nullptr);
+
+// Decodes a YOLOv8 head output as laid out by the model, channel major ([4 + classes, predictions]: cx, cy, w, h planes
+// followed by one score plane per class). Scores go through a running argmax (one prediction per SIMD lane), and only
+// predictions whose best score beats the threshold have their geometry read. Boxes are mapped back from input pixels with
+// (v - inputPadding) / inputScale and written to detections (cleared first, so its capacity is reused across frames).
+void decodeYOLOv8(const float* output, int predictionCount, int classCount, float confidenceThreshold, const cv::Vec2f& inputScale,
+				  const cv::Vec2f& inputPadding, std::vector<DetectionBox>& detections);
+
+// Reference decoder (transposes the output, then a minMaxLoc per prediction), kept to validate and benchmark the one above
+void decodeYOLOv8Reference(const float* output, int predictionCount, int classCount, float confidenceThreshold, const cv::Vec2f& inputScale,
+						   const cv::Vec2f& inputPadding, cv::Mat& transposedOutput, std::vector<DetectionBox>& detections);
+
+// Decodes RF_DETR outputs (boxes [queries, 4] as relative cx, cy, w, h and logits [queries, classes]), keeping the
+// maxDetections best query/class pairs at or above the threshold, best first. The threshold is moved to logit space once,
+// so only the surviving logits go through the sigmoid, and only those get selected (nth_element) and sorted.
+// Candidates is scratch space, reused across frames along with detections.
+void decodeRFDETR(const float* boxes, const float* logits, int queryCount, int classCount, float confidenceThreshold, int maxDetections,
+				  const cv::Size& inputSize, const cv::Vec2f& inputScale, const cv::Vec2f& inputPadding,
+				  std::vector<std::pair<float, int>>& candidates, std::vector<DetectionBox>& detections);
+
+// Reference decoder (sigmoid on every logit, then a partial_sort of all of them), kept to validate and benchmark the one above
+void decodeRFDETRReference(const float* boxes, const float* logits, int queryCount, int classCount, float confidenceThreshold, int maxDetections,
+						   const cv::Size& inputSize, const cv::Vec2f& inputScale, const cv::Vec2f& inputPadding,
+						   std::vector<DetectionBox>& detections);
@@ -0,0 +1,68 @@
+#pragma once
+
+// Std dependencies
+#include <algorithm>
+#include <cassert>
+
+// Third party dependencies
+#include <opencv2/core.hpp>
+
+struct DetectionBox
+{
+    float x, y, w, h;
+    int classId;
+	float confidence = -1.0f; // Optional, can be used to store confidence score
+
+	bool IsSimilar(const DetectionBox& other, float centerThreshold = 100.0f, float overlapRatioThreshold = 0.3f) const
+	{
+		// TODO: Re-evaluate this function
+		// // Check center distance first
+		// float cx1 = x + w / 2;
+		// float cy1 = y + h / 2;
+		// float cx2 = other.x + other.w / 2;
+		// float cy2 = other.y + other.h / 2;
+		// float dist = std::sqrt(std::pow(cx1 - cx2, 2) + std::pow(cy1 - cy2, 2));
+		// if (dist > centerThreshold) return false;
+
+		// Check border distance, against threshold
+		float x1 = x;
+		float y1 = y;
+		float x2 = x + w;
+		float y2 = y + h;
+
+		float x3 = other.x;
+		float y3 = other.y;
+		float x4 = other.x + other.w;
+		float y4 = other.y + other.h;
+
+		float dx = std::min(x2, x4) - std::max(x1, x3);
+		float dy = std::min(y2, y4) - std::max(y1, y3);
+
+		if (dx <= 0 || dy <= 0) return false;
+
+		float overlapArea = dx * dy;
+		float area1 = w * h;
+		float area2 = other.w * other.h;
+		// TODO: Perhaps just use area1 here, as this function related to the current box
+		float overlapRatio = overlapArea / std::min(area1, area2);
+
+		// If there is more overlap than the threshold, consider it similar
+		return overlapRatio > overlapRatioThreshold;
+	}
+
+	cv::Point GetCenter() const
+	{
+		return cv::Point(x + w / 2, y + h / 2);
+	}
+
+	DetectionBox Merge(const DetectionBox& other) const
+	{
+		assert(classId == other.classId && "Can't merge boxes of different classes!");
+
+		float x1 = std::min(x, other.x);
+		float y1 = std::min(y, other.y);
+		float x2 = std::max(x + w, other.x + other.w);
+		float y2 = std::max(y + h, other.y + other.h);
+		return { x1, y1, x2 - x1, y2 - y1, classId };
+	}
+};
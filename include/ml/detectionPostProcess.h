@@ -0,0 +1,73 @@
+#pragma once
+
+// Std dependencies
+#include <cstdint>
+#include <vector>
+
+// Internal dependencies
+#include <ml/detectionBox.h>
+
+enum PostProcessMode
+{
+	// Detections are left as decoded
+	POSTPROCESS_NONE = 0,
+	// Greedy NMS, boxes overlapping a better scored one are dropped
+	POSTPROCESS_NMS = 1,
+	// Gaussian soft-NMS, overlapping boxes have their score decayed instead of being dropped
+	POSTPROCESS_SOFT_NMS = 2,
+	// Overlapping boxes are merged into the box enclosing them (what the tasks always did)
+	POSTPROCESS_MERGE = 3
+};
+
+static const char* PostProcessModeNames[] = { "None", "NMS", "Soft-NMS", "Merge" };
+
+struct PostProcessConfig
+{
+	PostProcessMode mode = POSTPROCESS_MERGE;
+	// Boxes of different classes never suppress (or merge with) each other
+	bool classAware = true;
+	// IoU above which NMS suppresses a box, for merging it is the intersection over the smaller box
+	float overlapThreshold = 0.3f;
+	// Soft-NMS decays scores by exp(-iou^2 / sigma), boxes falling under the minimum score are dropped
+	float softNmsSigma = 0.5f;
+	float softNmsMinScore = 0.001f;
+};
+
+// Suppresses or merges overlapping detections. Boxes are kept as structure of arrays sorted by class then score,
+// so each box is compared against a contiguous run of candidates (overlaps computed a register at a time).
+// Every buffer is reused across calls.
+class DetectionPostProcessor
+{
+public:
+	DetectionPostProcessor() = default;
+	~DetectionPostProcessor() = default;
+
+	void SetConfig(const PostProcessConfig& config) { _config = config; }
+	const PostProcessConfig& GetConfig() const { return _config; }
+	void SetMode(PostProcessMode mode) { _config.mode = mode; }
+
+	// Detections are replaced by the kept ones, grouped by class and best scored first
+	void Process(std::vector<DetectionBox>& detections);
+
+private:
+	void load(const std::vector<DetectionBox>& detections);
+	void swapBoxes(int a, int b);
+	// Overlaps of box i against boxes [begin, end), written to _overlaps[0, end - begin)
+	void computeOverlaps(int i, int begin, int end, bool overSmallest);
+
+	void nms(int begin, int end);
+	void softNms(int begin, int end);
+	void merge(int begin, int end);
+
+	PostProcessConfig _config;
+
+	// Structure of arrays storage
+	std::vector<float> _x1, _y1, _x2, _y2, _areas, _scores;
+	std::vector<int> _classIds;
+	std::vector<uint8_t> _kept;
+	std::vector<int> _order;
+	std::vector<float> _overlaps;
+};
+
+// Reference O(n^2) merge loop the tasks used (IsSimilar + Merge with swap and pop), kept to validate and benchmark against
+void mergeOverlappingReference(std::vector<DetectionBox>& detections);
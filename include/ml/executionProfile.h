@@ -0,0 +1,122 @@
+#pragma once
+
+// Std dependencies
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Third party dependencies
+#include <opencv2/core.hpp>
+
+enum ThreadAffinity
+{
+	// Threads are placed by the OS
+	AFFINITY_NONE = 0,
+	// Threads pinned to consecutive logical processors, after the calling thread's
+	AFFINITY_COMPACT = 1,
+	// Threads pinned to every other logical processor (one per physical core on SMT machines)
+	AFFINITY_SPREAD = 2,
+	// Explicit ORT affinity string, e.g. to keep every thread on the cores of one NUMA node
+	AFFINITY_CUSTOM = 3
+};
+
+static const char* ThreadAffinityNames[] = { "None", "Compact", "Spread", "Custom" };
+
+// How an ONNX session is executed on the CPU, tuned per model and machine
+struct ExecutionProfile
+{
+	// Sessions run on the single threaded global pools of the ModelRegistry (the way every model used to run),
+	// the thread settings below only apply to sessions that opt out and get pools of their own
+	bool useGlobalThreadPools = true;
+	// Zero lets ORT pick (one thread per physical core)
+	int intraOpThreads = 1;
+	int interOpThreads = 1;
+	ThreadAffinity affinity = AFFINITY_NONE;
+	// ORT syntax, one entry per intra op thread besides the caller, e.g. "2;3;4" or "2-3;4-5" (1-based processors)
+	std::string customAffinity;
+	// Idle pool threads spin for a while before blocking, lower latency for a busier CPU
+	bool allowSpinning = true;
+
+	// Memory planning over the first runs, reused as long as the input shape doesn't change
+	bool memoryPattern = true;
+	bool cpuArena = true;
+	// Independent branches of the graph run in parallel on the inter op pool
+	bool parallelExecution = false;
+
+	// Steady state latency measured by the tuner (zero when the profile wasn't tuned)
+	double tunedLatency = 0.0;
+
+	// Identifies the settings that matter for the session, models only share sessions when these match
+	std::string GetKey() const;
+	// ORT intra op affinity string for the profile (empty when threads aren't pinned)
+	std::string GetAffinityString() const;
+	// Short human readable summary
+	std::string ToString() const;
+};
+
+// Tuned profiles, persisted to a JSON file and keyed on the machine and the model file name
+class ExecutionProfileStore
+{
+public:
+	static ExecutionProfileStore& GetInstance()
+	{
+		static ExecutionProfileStore instance;
+		return instance;
+	}
+
+	ExecutionProfileStore(ExecutionProfileStore const&) = delete;
+	void operator=(ExecutionProfileStore const&) = delete;
+
+	bool Load(const std::filesystem::path& path = "execution_profiles.json");
+	bool Save(const std::filesystem::path& path = "execution_profiles.json");
+
+	bool Find(const std::filesystem::path& modelPath, bool useCuda, ExecutionProfile& profile);
+	void Set(const std::filesystem::path& modelPath, bool useCuda, const ExecutionProfile& profile);
+
+	// Host name and logical processor count, profiles tuned elsewhere don't apply
+	static std::string GetMachineKey();
+
+private:
+	ExecutionProfileStore() = default;
+	~ExecutionProfileStore() = default;
+
+	std::string getKey(const std::filesystem::path& modelPath, bool useCuda) const;
+
+	std::mutex _mutex;
+	bool _loaded = false;
+	std::unordered_map<std::string, ExecutionProfile> _profiles;
+};
+
+class PreProcessBoxDetectionBase;
+
+// Sweeps the execution settings of a model over a set of recorded frames and keeps the fastest profile.
+// Settings are swept one at a time (coordinate descent), each keeping the best value found so far,
+// so the sweep grows with the number of values instead of their combinations.
+class ExecutionTuner
+{
+public:
+	// Creates a new (unloaded) model of the type to tune
+	using ModelFactory = std::function<PreProcessBoxDetectionBase*()>;
+
+	ExecutionTuner(ModelFactory createModel, int iterations = 20) : _createModel(std::move(createModel)), _iterations(std::max(1, iterations)) {}
+
+	// Returns the fastest profile (its tunedLatency set), false when the model couldn't be loaded
+	bool Tune(const std::filesystem::path& modelPath, const std::vector<cv::Mat>& frames, ExecutionProfile& bestProfile);
+
+	// Every profile measured by the last Tune call, in order
+	const std::vector<ExecutionProfile>& GetMeasuredProfiles() const { return _measured; }
+
+private:
+	// Median latency of the profile over the frames, negative when loading failed
+	double measure(const std::filesystem::path& modelPath, const std::vector<cv::Mat>& frames, const ExecutionProfile& profile);
+	void tryProfile(const std::filesystem::path& modelPath, const std::vector<cv::Mat>& frames, const ExecutionProfile& profile,
+					ExecutionProfile& bestProfile);
+
+	ModelFactory _createModel;
+	int _iterations;
+	std::vector<ExecutionProfile> _measured;
+};
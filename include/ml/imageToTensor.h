@@ -0,0 +1,80 @@
+#pragma once
+
+// Std dependencies
+#include <cstdint>
+#include <vector>
+
+// Third party dependencies
+#include <opencv2/core.hpp>
+
+// Packs an 8-bit BGR or BGRA image into planar float (CHW) tensor data, computing
+// pixel * scale[c] + offset[c] for every output channel c. Output channels are in
+// RGB order when swapRB is set, and the alpha channel (if any) is dropped.
+// The tensor must hold 3 * image.rows * image.cols floats.
+void packImageToTensor(const cv::Mat& image, float* tensor, const float scale[3], const float offset[3], bool swapRB);
+
+// Same as above, writing the image at origin inside planes of planeSize (pixels outside it are left untouched)
+void packImageToTensor(const cv::Mat& image, float* tensor, const cv::Size& planeSize, const cv::Point& origin, const float scale[3],
+					   const float offset[3], bool swapRB);
+
+enum PreProcessMode
+{
+	// Resize in 8-bit, then a single SIMD pass normalizes, swaps to RGB and packs to CHW
+	PREPROCESS_FUSED = 0,
+	// Reference path made of separate OpenCV passes (resize, convertTo, per channel math, blobFromImage)
+	PREPROCESS_OPENCV = 1
+};
+
+// How a model expects its input, each model class fills it with what it was trained on
+struct PreProcessConfig
+{
+	PreProcessMode mode = PREPROCESS_FUSED;
+	// Keep the aspect ratio, filling the borders with padValue (before normalization)
+	bool letterbox = false;
+	uint8_t padValue = 114;
+	// Per output channel, value = pixel * scale + offset
+	float scale[3] = { 1 / 255.0f, 1 / 255.0f, 1 / 255.0f };
+	float offset[3] = { 0.0f, 0.0f, 0.0f };
+	bool swapRB = true;
+};
+
+// Turns 8-bit BGR/BGRA images into the 1x3xHxW float blob fed to the models,
+// every buffer (including the blob) is reused as long as the sizes don't change
+class ImagePreProcessor
+{
+public:
+	ImagePreProcessor() = default;
+	~ImagePreProcessor() = default;
+
+	void SetConfig(const PreProcessConfig& config);
+	const PreProcessConfig& GetConfig() const { return _config; }
+	void SetMode(PreProcessMode mode) { _config.mode = mode; }
+	void SetLetterbox(bool letterbox);
+
+	void Process(const cv::Mat& image, const cv::Size& inputSize);
+	// Packs every image into one Nx3xHxW blob (batch index i holds images[i])
+	void ProcessBatch(const cv::Mat* images, int count, const cv::Size& inputSize);
+	void ProcessBatch(const std::vector<cv::Mat>& images, const cv::Size& inputSize) { ProcessBatch(images.data(), (int)images.size(), inputSize); }
+
+	cv::Mat& GetBlob() { return _blob; }
+	int GetBatchSize() const { return (int)_scales.size(); }
+	cv::Size GetInputSize() const { return _inputSize; }
+	// Maps input (model) coordinates of a batch item back to its image: image = (input - padding) / scale
+	cv::Vec2f GetScale(int batchIndex = 0) const { return _scales.empty() ? cv::Vec2f(1.0f, 1.0f) : _scales[batchIndex]; }
+	cv::Vec2f GetPadding(int batchIndex = 0) const { return _paddings.empty() ? cv::Vec2f(0.0f, 0.0f) : _paddings[batchIndex]; }
+
+private:
+	void processFused(const cv::Mat& image, const cv::Rect& imageRect, float* tensor, cv::Rect& previousImageRect);
+	void processOpenCV(const cv::Mat& image, const cv::Rect& imageRect, float* tensor);
+
+	PreProcessConfig _config;
+	cv::Mat _resized;
+	cv::Mat _floatImage;
+	cv::Mat _openCVBlob;
+	cv::Mat _blob;
+	cv::Size _inputSize;
+	// Where each image landed inside its input, the padding around it is only refilled when it moves
+	std::vector<cv::Rect> _imageRects;
+	std::vector<cv::Vec2f> _scales;
+	std::vector<cv::Vec2f> _paddings;
+};
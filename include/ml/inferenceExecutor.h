@@ -0,0 +1,121 @@
+#pragma once
+
+// Std dependencies
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Third party dependencies
+#include <opencv2/core.hpp>
+
+// Internal dependencies
+#include <ml/onnxruntimeInference.h>
+#include <ml/tiledInference.h>
+#include <system/framePool.h>
+
+// Detections of an inference request, tagged with the frame and rect they were computed on
+struct InferenceResult
+{
+	uint64_t sequence = 0;
+	// Rect of the frame the model ran on (frame coordinates), detections are relative to it
+	cv::Rect rect;
+	std::vector<DetectionBox> detections;
+	// Superseded by a newer request before it got to run
+	bool dropped = false;
+	std::chrono::steady_clock::time_point submitTime;
+	std::chrono::steady_clock::time_point finishTime;
+};
+
+// Runs a model on a worker thread, so slow inference doesn't stall the caller (e.g. the UI thread).
+// Requests beyond the queue depth drop the oldest queued one, only the freshest frames get processed.
+class InferenceExecutor
+{
+  public:
+	// Called from the worker thread for every request that ran (dropped requests only resolve their future)
+	using Callback = std::function<void(const InferenceResult&)>;
+
+	InferenceExecutor(size_t queueDepth = 1);
+	~InferenceExecutor();
+
+	InferenceExecutor(const InferenceExecutor&) = delete;
+	InferenceExecutor& operator=(const InferenceExecutor&) = delete;
+
+	// Model used by the requests, queued requests are dropped and the running one finishes first
+	// (the model must not be used elsewhere while requests are pending, see WaitIdle)
+	void SetModel(PreProcessBoxDetectionBase* model);
+	void SetQueueDepth(size_t queueDepth);
+	// Runs the requests over overlapping native resolution tiles of their rect instead of a single downscaled view
+	void SetTiling(bool enabled, const TilingConfig& config = TilingConfig());
+	bool IsTiling() const { return _tiling; }
+
+	// Queues inference of a rect (frame coordinates) of the frame, the handle keeps the frame alive until it ran
+	std::future<InferenceResult> Submit(const FrameHandle& frame, const cv::Rect& rect, float confidenceThreshold, Callback callback = nullptr);
+	// Queues inference whose result goes to the latest result slot, replacing the one not taken yet (see TakeLatestResult)
+	void SubmitLatest(const FrameHandle& frame, const cv::Rect& rect, float confidenceThreshold);
+	// Moves out the latest result, false when none arrived since the last call
+	bool TakeLatestResult(InferenceResult& result);
+	bool HasLatestResult();
+	// Waits for the worker and runs the model on the calling thread (same model and tiling as the requests),
+	// the caller must not submit from another thread meanwhile
+	void RunNow(const FrameHandle& frame, const cv::Rect& rect, float confidenceThreshold, std::vector<DetectionBox>& detections);
+
+	// Drops the queued requests
+	void Cancel();
+	// Blocks until the queue is empty and the worker is done with the model
+	void WaitIdle();
+
+	size_t GetSubmittedCount() const { return _submittedCount; }
+	size_t GetCompletedCount() const { return _completedCount; }
+	size_t GetDroppedCount() const { return _droppedCount; }
+	// Whether a request is queued or running (turns false only after its callback returned)
+	bool HasPending() const { return _submittedCount != _completedCount + _droppedCount; }
+	// Submit to finish time of the last completed request, in milliseconds
+	double GetLastLatency() const { return _lastLatency; }
+
+  private:
+	struct Request
+	{
+		FrameHandle frame;
+		cv::Rect rect;
+		float confidenceThreshold;
+		Callback callback;
+		std::promise<InferenceResult> promise;
+		std::chrono::steady_clock::time_point submitTime;
+	};
+
+	void workerLoop();
+	void drop(Request& request);
+	void infer(PreProcessBoxDetectionBase* model, const FrameHandle& frame, const cv::Rect& rect, float confidenceThreshold,
+			   std::vector<DetectionBox>& detections);
+
+	PreProcessBoxDetectionBase* _model = nullptr;
+	size_t _queueDepth;
+
+	// Only touched by the worker while requests are pending
+	bool _tiling = false;
+	TiledDetector _tiledDetector;
+	float _tiledThreshold = -1.0f;
+
+	std::mutex _mutex;
+	std::condition_variable _requestCondition;
+	std::condition_variable _idleCondition;
+	std::deque<Request> _requests;
+	bool _busy = false;
+	bool _stopping = false;
+	std::thread _worker;
+
+	std::mutex _latestResultMutex;
+	InferenceResult _latestResult;
+	bool _hasLatestResult = false;
+
+	std::atomic<size_t> _submittedCount = 0;
+	std::atomic<size_t> _completedCount = 0;
+	std::atomic<size_t> _droppedCount = 0;
+	std::atomic<double> _lastLatency = 0.0;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+// Std dependencies
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Third party dependencies
+#include <onnxruntime_cxx_api.h>
+
+// Singleton owning the process wide ORT environment (and its global thread pools),
+// loaded sessions are shared between every model created from the same file and options
+class ModelRegistry
+{
+public:
+	static ModelRegistry& GetInstance()
+	{
+		static ModelRegistry instance;
+		return instance;
+	}
+
+	ModelRegistry(ModelRegistry const&) = delete;
+	void operator=(ModelRegistry const&) = delete;
+
+	Ort::Env& GetEnv() { return _env; }
+
+	// Returns the resident session for the key, or creates it when there is none (created tells which happened),
+	// sessions are reference counted and unloaded once the last model using them is gone
+	std::shared_ptr<Ort::Session> Acquire(const std::string& key, const std::function<void(Ort::Session&)>& create, bool& created);
+
+	// Number of sessions currently loaded
+	size_t GetResidentCount();
+
+private:
+	ModelRegistry();
+	~ModelRegistry() = default;
+
+	// Declared first, sessions can't outlive the environment
+	Ort::Env _env{nullptr};
+
+	std::mutex _mutex;
+	std::unordered_map<std::string, std::weak_ptr<Ort::Session>> _sessions;
+};
@@ -1,11 +1,19 @@
 #pragma once
 #include <onnxruntime_cxx_api.h>
 
+#include <filesystem>
+
 #include <opencv2/core.hpp>
 #include <opencv2/dnn/dnn.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/videoio.hpp>
 
+#include <ml/boxDecoders.h>
+#include <ml/detectionBox.h>
+#include <ml/executionProfile.h>
+#include <ml/imageToTensor.h>
+#include <system/framePool.h>
+
 
 // Common functions
 class OnnxInferenceBase
@@ -13,91 +21,87 @@ class OnnxInferenceBase
   public:
 	OnnxInferenceBase() = delete;
 	OnnxInferenceBase(const std::vector<const char*>& inputNodeNames, const std::vector<const char*>& outputNodeNames)
-		: _session(Ort::Session(nullptr)), _inputNodeNames(inputNodeNames), _outputNodeNames(outputNodeNames)
+		: _inputNodeNames(inputNodeNames), _outputNodeNames(outputNodeNames)
 	{
-		// Make sure the environment is initialized
-		_env = Ort::Env(OrtLoggingLevel::ORT_LOGGING_LEVEL_WARNING, "Default");
 	}
 	virtual ~OnnxInferenceBase() = default;
 
-	// Create session
+	// Create session (or share the one already loaded from the same file and options)
 	virtual bool LoadModel(bool useCuda, const wchar_t* modelPath);
-	virtual int Inference(cv::Mat& frame, std::vector<Ort::Value>& outputTensor) = 0;
+	// Runs the model on the frame, outputs are left in _outputValues (returns the element count of the first output, -1 on error)
+	virtual int Inference(cv::Mat& frame) = 0;
+
+	// Binds persistent input/output buffers to the session, so steady state runs don't allocate
+	// (only possible when every output has a static shape, otherwise outputs are allocated per run)
+	void SetIoBinding(bool enabled) { _useIoBinding = enabled; }
+	bool IsUsingIoBinding() const { return _useIoBinding && _ioBindingReady; }
+
+	// Fully optimizes the graph once and keeps the result next to the source model, later loads reuse it
+	// (when disabled models are loaded unoptimized, keeping startup fast at the cost of slower inference)
+	void SetModelCache(bool enabled) { _useModelCache = enabled; }
+	// Cached model file for the source model, named after the execution provider setup and keyed on the model content,
+	// the ORT version, that setup and the machine
+	std::filesystem::path GetCachedModelPath(const std::filesystem::path& modelPath, bool useCuda) const;
+
+	// CPU execution settings used by the next LoadModel, otherwise the profile tuned for the model on this machine
+	// (see ExecutionProfileStore) or the defaults are used
+	void SetExecutionProfile(const ExecutionProfile& profile)
+	{
+		_executionProfile = profile;
+		_hasExecutionProfile = true;
+	}
+	const ExecutionProfile& GetExecutionProfile() const { return _executionProfile; }
+
+	// Time spent creating the session by the last LoadModel call, in milliseconds (zero when it was already resident)
+	double GetLoadTime() const { return _loadTime; }
+	bool IsLoadedFromCache() const { return _loadedFromCache; }
+	const std::vector<int64_t>& GetInputShape() const { return _inputNodeDims; }
+	// Models exported with a dynamic batch dimension can run several images at once
+	bool SupportsBatching() const { return !_inputNodeDims.empty() && _inputNodeDims[0] <= 0; }
+
+	// Outputs of the last inference (valid until the next one)
+	size_t GetOutputCount() const { return _outputShapes.size(); }
+	const float* GetOutputData(size_t index) const { return _outputValues[index].GetTensorData<float>(); }
+	const std::vector<int64_t>& GetOutputShape(size_t index) const { return _outputShapes[index]; }
 
   protected:
 	void setSessionOptions(bool useCuda);
+	void createSession(const std::filesystem::path& modelPath, bool useCuda, Ort::Session& session);
+	// Execution provider (and machine) part of the cached model names, each provider setup and machine keeps its own cache
+	std::string getCacheProvider(bool useCuda) const;
+	bool bindOutputs();
+	int run(float* inputData, size_t inputSize, int64_t batchSize = 1);
 
-	Ort::Env _env;
-	Ort::Session _session;
+
+	// Owned by the ModelRegistry, shared with other models loaded from the same file
+	std::shared_ptr<Ort::Session> _session;
 	Ort::SessionOptions _sessionOptions;
 	OrtCUDAProviderOptions _cudaOptions;
+	ExecutionProfile _executionProfile;
+	bool _hasExecutionProfile = false;
 	Ort::MemoryInfo _memoryInfo{nullptr};
 
 	std::vector<const char*> _inputNodeNames;
 	std::vector<const char*> _outputNodeNames;
 	std::vector<int64_t> _inputNodeDims;
-
-	cv::Mat _blob;
-};
-
-struct DetectionBox
-{
-    float x, y, w, h;
-    int classId;
-	float confidence = -1.0f; // Optional, can be used to store confidence score
-
-	bool IsSimilar(const DetectionBox& other, float centerThreshold = 100.0f, float overlapRatioThreshold = 0.3f) const
-	{
-		// TODO: Re-evaluate this function
-		// // Check center distance first
-		// float cx1 = x + w / 2;
-		// float cy1 = y + h / 2;
-		// float cx2 = other.x + other.w / 2;
-		// float cy2 = other.y + other.h / 2;
-		// float dist = std::sqrt(std::pow(cx1 - cx2, 2) + std::pow(cy1 - cy2, 2));
-		// if (dist > centerThreshold) return false;
-
-		// Check border distance, against threshold
-		float x1 = x;
-		float y1 = y;
-		float x2 = x + w;
-		float y2 = y + h;
-
-		float x3 = other.x;
-		float y3 = other.y;
-		float x4 = other.x + other.w;
-		float y4 = other.y + other.h;
-
-		float dx = std::min(x2, x4) - std::max(x1, x3);
-		float dy = std::min(y2, y4) - std::max(y1, y3);
-
-		if (dx <= 0 || dy <= 0) return false;
-
-		float overlapArea = dx * dy;
-		float area1 = w * h;
-		float area2 = other.w * other.h;
-		// TODO: Perhaps just use area1 here, as this function related to the current box
-		float overlapRatio = overlapArea / std::min(area1, area2);
-
-		// If there is more overlap than the threshold, consider it similar
-		return overlapRatio > overlapRatioThreshold;
-	}
-
-	cv::Point GetCenter() const
-	{
-		return cv::Point(x + w / 2, y + h / 2);
-	}
-
-	DetectionBox Merge(const DetectionBox& other) const
-	{
-		assert(classId == other.classId && "Can't merge boxes of different classes!");
-
-		float x1 = std::min(x, other.x);
-		float y1 = std::min(y, other.y);
-		float x2 = std::max(x + w, other.x + other.w);
-		float y2 = std::max(y + h, other.y + other.h);
-		return { x1, y1, x2 - x1, y2 - y1, classId };
-	}
+	// Shape of the input fed to the last run (the batch size filled in)
+	std::vector<int64_t> _inputShape;
+
+	// Optimized model cache
+	bool _useModelCache = true;
+	bool _loadedFromCache = false;
+	double _loadTime = 0.0;
+
+	// Run state, bound once after the model loads when IoBinding is used
+	Ort::RunOptions _runOptions;
+	Ort::IoBinding _ioBinding{nullptr};
+	bool _useIoBinding = true;
+	bool _ioBindingReady = false;
+	Ort::Value _inputValue{nullptr};
+	const float* _boundInputData = nullptr;
+	std::vector<std::vector<float>> _outputBuffers;
+	std::vector<Ort::Value> _outputValues;
+	std::vector<std::vector<int64_t>> _outputShapes;
 };
 
 class PreProcessBoxDetectionBase : public OnnxInferenceBase
@@ -109,53 +113,85 @@ class PreProcessBoxDetectionBase : public OnnxInferenceBase
 	}
 	virtual ~PreProcessBoxDetectionBase() = default;
 
-	virtual void Inference(cv::Mat& frame, std::vector<DetectionBox>& detectionBoxes) = 0;
+	virtual void Inference(cv::Mat& frame, std::vector<DetectionBox>& detectionBoxes);
+	// Input tensor the model would run on for the frame (a view of the preprocessing blob, valid until the next inference),
+	// e.g. to export calibration data for quantization
+	bool PrepareInput(cv::Mat& frame, cv::Mat& tensor);
+	// Runs on the coarsest pyramid level of the frame that still fits the model input,
+	// boxes are relative to the rect (frame coordinates) and in full resolution
+	void InferenceOnFrame(const FrameHandle& frame, const cv::Rect& rect, std::vector<DetectionBox>& detectionBoxes);
+
+	// Packs the images (up to the max batch size at a time) into a single NCHW run and scatters the boxes back,
+	// detectionBoxes[i] holding the ones of images[i]. Models with a static batch run the images one by one.
+	void InferenceBatch(const std::vector<cv::Mat>& images, std::vector<std::vector<DetectionBox>>& detectionBoxes);
+	// Same as InferenceOnFrame for several rects of the frame, batched
+	void InferenceBatchOnFrame(const FrameHandle& frame, const std::vector<cv::Rect>& rects, std::vector<std::vector<DetectionBox>>& detectionBoxes);
+	void SetMaxBatchSize(int maxBatchSize) { _maxBatchSize = std::max(1, maxBatchSize); }
 
 	void SetConfidenceThreshold(float threshold) { _confidenceThreshold = threshold; }
 	void SetClassNumber(int classNumber) { _classNumber = classNumber; }
+	void SetPreProcessMode(PreProcessMode mode) { _preProcessor.SetMode(mode); }
+	void SetLetterbox(bool letterbox) { _preProcessor.SetLetterbox(letterbox); }
 
   protected:
-	virtual bool preProcess(cv::Mat& frame, std::vector<Ort::Value>& inputTensor) = 0;
-	virtual int Inference(cv::Mat& frame, std::vector<Ort::Value>& outputTensor) final;
+	virtual bool preProcess(cv::Mat& frame);
+	virtual int Inference(cv::Mat& frame) override final;
+	// Turns the outputs of a batch item from the last run into boxes, in the coordinates of its image
+	virtual void decode(int batchIndex, std::vector<DetectionBox>& detectionBoxes) = 0;
+	// View of the rect on the coarsest pyramid level that still fits the model input, and the scale back to full resolution
+	bool getLevelView(const FrameHandle& frame, const cv::Rect& rect, cv::Mat& levelView, cv::Vec2f& levelScale) const;
 
 	// Model specific config
 	int _classNumber;
 	float _confidenceThreshold;
+	int _maxBatchSize = 8;
+	ImagePreProcessor _preProcessor;
+
+	// Batching state, reused across calls
+	std::vector<cv::Mat> _batchImages;
+	std::vector<cv::Vec2f> _batchScales;
+	std::vector<cv::Mat> _batchPacked;
+	std::vector<int> _batchItems;
 };
 
 class YOLOv8 : public PreProcessBoxDetectionBase
 {
   public:
-	YOLOv8(int classNumber, float confidenceThreshold) : PreProcessBoxDetectionBase(classNumber, confidenceThreshold, { "images" }, { "output0" })
-	{
-	}
+	YOLOv8(int classNumber, float confidenceThreshold);
 	virtual ~YOLOv8() = default;
 
-	virtual void Inference(cv::Mat& frame, std::vector<DetectionBox>& detectionBoxes) override;
+	// Also picks the decoder specialized for the head (class count and layout, told from the output shape)
+	virtual bool LoadModel(bool useCuda, const wchar_t* modelPath) override;
 
-  protected:
-	virtual bool preProcess(cv::Mat& frame, std::vector<Ort::Value>& inputTensor) override;
+	// Geometry of the boxes, can't be told from the output shape (YOLOv8 exports are in input pixels)
+	void SetBoxEncoding(BoxEncoding encoding)
+	{
+		_boxEncoding = encoding;
+		_decoder = nullptr;
+	}
+	OutputLayout GetOutputLayout() const { return _outputLayout; }
 
-	// Inference state
-	std::vector<Ort::Value> _outputTensor;
-	cv::Vec2f _outputScaling;
+  protected:
+	virtual void decode(int batchIndex, std::vector<DetectionBox>& detectionBoxes) override;
+	void selectDecoder(int classCount);
+
+	// Decoder of the loaded head, picked again if the decoded class count changes
+	BoxEncoding _boxEncoding = BOX_CXCYWH_PIXELS;
+	OutputLayout _outputLayout = LAYOUT_CHANNEL_MAJOR;
+	YOLOv8DecodeFunction _decoder = nullptr;
+	int _decoderClassCount = 0;
 };
 
 class RF_DETR : public PreProcessBoxDetectionBase
 {
   public:
-	RF_DETR(int classNumber, float confidenceThreshold) : PreProcessBoxDetectionBase(classNumber, confidenceThreshold, { "input" }, { "dets", "labels" })
-	{
-	}
+	RF_DETR(int classNumber, float confidenceThreshold);
 
 	virtual ~RF_DETR() = default;
 
-	virtual void Inference(cv::Mat& frame, std::vector<DetectionBox>& detectionBoxes) override;
-
   protected:
-	virtual bool preProcess(cv::Mat& frame, std::vector<Ort::Value>& inputTensor) override;
+	virtual void decode(int batchIndex, std::vector<DetectionBox>& detectionBoxes) override;
 
-	// Inference state
-	std::vector<Ort::Value> _outputTensor;
-	cv::Vec2f _outputScaling;
+	// Decoding state, reused across frames
+	std::vector<std::pair<float, int>> _candidates;
 };
@@ -0,0 +1,94 @@
+#pragma once
+
+// Std dependencies
+#include <cstdint>
+#include <vector>
+
+// Third party dependencies
+#include <opencv2/core.hpp>
+
+// Internal dependencies
+#include <ml/detectionPostProcess.h>
+#include <ml/onnxruntimeInference.h>
+#include <system/framePool.h>
+
+enum TileSelection
+{
+	// Every tile runs on every call
+	TILES_ALL = 0,
+	// Only tiles with pixels changed since they last ran, the others reuse their previous detections
+	TILES_CHANGED = 1
+};
+
+static const char* TileSelectionNames[] = { "All", "Changed" };
+
+struct TilingConfig
+{
+	// Side of the square tiles in frame pixels (0 uses the model input size, so tiles run at native resolution)
+	int tileSize = 0;
+	// Fraction of a tile shared with its neighbours, objects smaller than the overlap are seen whole by at least one tile
+	float overlap = 0.2f;
+	TileSelection selection = TILES_ALL;
+};
+
+// Runs a model over overlapping tiles of a frame rect instead of a single downscaled view of it, so small objects
+// keep their pixels. Tiles are batched into as few runs as the model allows, their detections are moved back
+// into rect coordinates and the duplicates found by neighbouring tiles are suppressed by the post processor.
+class TiledDetector
+{
+  public:
+	TiledDetector();
+	~TiledDetector() = default;
+
+	// Model used for the tiles (not owned), changing it drops the reusable detections
+	void SetModel(PreProcessBoxDetectionBase* model);
+	void SetConfig(const TilingConfig& config);
+	const TilingConfig& GetConfig() const { return _config; }
+	// Stitching of the tiles, merges overlapping boxes of the same class by default
+	void SetPostProcessConfig(const PostProcessConfig& config) { _postProcessor.SetConfig(config); }
+	const PostProcessConfig& GetPostProcessConfig() const { return _postProcessor.GetConfig(); }
+
+	// Forces every tile to run on the next call (e.g. after the model threshold changed)
+	void Invalidate();
+
+	// Runs the model on the tiles of the rect (frame coordinates), boxes are relative to the rect
+	void Inference(const FrameHandle& frame, const cv::Rect& rect, std::vector<DetectionBox>& detectionBoxes);
+
+	// Tiles covering the rect of the last call, and how many of them actually ran
+	int GetTileCount() const { return (int)_tiles.size(); }
+	int GetRunTileCount() const { return _runTileCount; }
+
+  private:
+	struct Tile
+	{
+		// Frame coordinates
+		cv::Rect rect;
+		// Frame the detections were computed on, only meaningful once valid
+		uint64_t sequence = 0;
+		bool valid = false;
+		// Tile coordinates, already filtered at the tile borders
+		std::vector<DetectionBox> boxes;
+	};
+
+	void layoutTiles(const cv::Rect& rect, int tileSize);
+	void filterBorderBoxes(const Tile& tile, std::vector<DetectionBox>& boxes) const;
+
+	PreProcessBoxDetectionBase* _model = nullptr;
+	TilingConfig _config;
+	DetectionPostProcessor _postProcessor;
+
+	// Layout of the last call, rebuilt when the rect or tile size changes
+	std::vector<Tile> _tiles;
+	cv::Rect _layoutRect;
+	int _layoutTileSize = 0;
+	// Smallest overlap between neighbouring tiles, per axis
+	cv::Size _minOverlap;
+	int _runTileCount = 0;
+
+	// Per call state, reused across calls
+	std::vector<int> _xStarts, _yStarts;
+	std::vector<int> _runTiles;
+	std::vector<cv::Mat> _tileImages;
+	std::vector<cv::Mat> _paddedTiles;
+	std::vector<std::vector<DetectionBox>> _tileBoxes;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+// Std dependencies
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Third party dependencies
+#include <opencv2/core.hpp>
+
+// Downscaled copies of a frame, built lazily and shared by every reader of the same frame
+struct FramePyramid
+{
+	std::mutex mutex;
+	// Level i + 1 lives at index i (level 0 is the frame image itself), each level halves the previous one
+	std::vector<cv::Mat> levels;
+	// Levels are kept when the frame is recycled, so rebuilding them doesn't allocate
+	int builtLevels = 0;
+};
+
+// A captured frame, immutable once published by the capture thread
+struct Frame
+{
+	cv::Mat image;
+	// Set when the image is a view into memory owned by the frame source (e.g. a mapped replay)
+	std::shared_ptr<const void> imageOwner;
+
+	// Area of the full capture covered by the image, in frame coordinates
+	cv::Rect region;
+
+	// Monotonic id, increases by one for every published frame
+	uint64_t sequence = 0;
+
+	// Sequence at which each tile of the full capture last changed (as of this frame)
+	int tileSize = 0;
+	cv::Size tileGrid;
+	std::vector<uint64_t> tileStamps;
+	std::chrono::steady_clock::time_point captureTime;
+	std::chrono::steady_clock::time_point publishTime;
+
+	// Built on demand by readers, the returned image is only valid while the frame handle is held
+	mutable FramePyramid pyramid;
+
+	bool Covers(const cv::Rect& rect) const { return !rect.empty() && (region & rect) == rect; }
+
+	// Read-only view of a rect (in frame coordinates) covered by this frame
+	cv::Mat View(const cv::Rect& rect) const { return image(rect - region.tl()); }
+
+	// Image downscaled by 2^level (level 0 being the image itself), the first request builds it
+	cv::Mat GetPyramidLevel(int level) const;
+
+	// Whether any pixel of the rect (in frame coordinates) changed after the given sequence
+	bool HasChangedSince(const cv::Rect& rect, uint64_t sinceSequence) const
+	{
+		if (tileSize <= 0 || rect.empty()) return true;
+
+		const cv::Rect tiles = cv::Rect(rect.x / tileSize, rect.y / tileSize, (rect.br().x - 1) / tileSize - rect.x / tileSize + 1,
+										(rect.br().y - 1) / tileSize - rect.y / tileSize + 1) & cv::Rect(cv::Point(0, 0), tileGrid);
+		for (int tileY = tiles.y; tileY < tiles.br().y; ++tileY)
+		{
+			for (int tileX = tiles.x; tileX < tiles.br().x; ++tileX)
+			{
+				if (tileStamps[tileY * tileGrid.width + tileX] > sinceSequence) return true;
+			}
+		}
+		return false;
+	}
+
+	// Sequence at which any pixel of the rect (in frame coordinates) last changed,
+	// the frame's own sequence when changes aren't tracked
+	uint64_t GetLastChange(const cv::Rect& rect) const
+	{
+		if (tileSize <= 0 || rect.empty()) return sequence;
+
+		const cv::Rect tiles = cv::Rect(rect.x / tileSize, rect.y / tileSize, (rect.br().x - 1) / tileSize - rect.x / tileSize + 1,
+										(rect.br().y - 1) / tileSize - rect.y / tileSize + 1) & cv::Rect(cv::Point(0, 0), tileGrid);
+		uint64_t lastChange = 0;
+		for (int tileY = tiles.y; tileY < tiles.br().y; ++tileY)
+		{
+			for (int tileX = tiles.x; tileX < tiles.br().x; ++tileX)
+			{
+				lastChange = std::max(lastChange, tileStamps[tileY * tileGrid.width + tileX]);
+			}
+		}
+		return lastChange;
+	}
+};
+
+
+// Read-only, ref-counted view of a published frame, the
+// underlying buffer goes back to the pool once the last
+// handle pointing to it is dropped
+using FrameHandle = std::shared_ptr<const Frame>;
+
+// Rect of a published frame, used to share crops between tasks along with where they came from
+struct FrameRegion
+{
+	FrameHandle frame;
+	cv::Rect rect;
+};
+
+// Pool of frame buffers recycled by the capture thread
+class FramePool
+{
+  public:
+	FramePool();
+	~FramePool() = default;
+
+	FramePool(const FramePool&) = delete;
+	FramePool& operator=(const FramePool&) = delete;
+
+	// Fetch a writable frame that no reader is holding
+	Frame* Acquire();
+
+	// Hand the frame over to readers, it can't be written to after this
+	FrameHandle Publish(Frame* frame);
+	// Give back a frame that was never published
+	void Recycle(Frame* frame);
+
+	// Number of frame buffers ever created by this pool
+	size_t GetAllocationCount() const;
+	size_t GetFreeCount() const;
+
+  private:
+	// Storage is shared with the published handles so
+	// frames can safely outlive the pool that created them
+	struct Storage
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<Frame>> frames;
+		std::vector<Frame*> freeFrames;
+	};
+
+	std::shared_ptr<Storage> _storage;
+};
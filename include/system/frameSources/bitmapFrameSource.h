@@ -0,0 +1,64 @@
+#pragma once
+
+// Std dependencies
+#include <cstdint>
+
+// Internal dependencies
+#include <system/iframeSource.h>
+
+// Raw pixels of a platform bitmap, rows are top-down and may be padded
+struct PixelBuffer
+{
+	uint8_t* data = nullptr;
+	int width = 0;
+	int height = 0;
+	size_t stride = 0;
+	int bitsPerPixel = 0;
+};
+
+// Wraps the bitmap memory in a cv::Mat header (no copy), empty if the pixel format is unsupported
+cv::Mat WrapPixels(const PixelBuffer& pixels);
+
+// Copies (and converts to the given format if needed) a region of the bitmap into the frame, reusing its memory when possible
+bool CopyPixels(const PixelBuffer& pixels, const cv::Rect& region, cv::Mat& outFrame, FramePixelFormat format);
+
+// Platform bitmap the screen contents are grabbed into
+class IBitmapProvider
+{
+public:
+	IBitmapProvider() = default;
+	virtual ~IBitmapProvider() = default;
+
+	// Size the bitmap should have to hold the whole source
+	virtual cv::Size GetSourceSize() = 0;
+
+	// (Re)creates the bitmap, only called when the source size or the frame format changes
+	virtual bool Allocate(const cv::Size& size, FramePixelFormat format) = 0;
+	virtual void Release() = 0;
+
+	// Copies a region of the source into the same region of the bitmap
+	virtual bool Grab(const cv::Rect& region) = 0;
+	virtual PixelBuffer GetPixels() const = 0;
+};
+
+// Frame source that keeps a provider bitmap alive across frames, only
+// rebuilding it when the source size changes, and copies it out directly
+class BitmapFrameSource : public IFrameSource
+{
+public:
+	// Takes ownership of the provider
+	BitmapFrameSource(IBitmapProvider* provider, const cv::Rect& captureRect);
+	virtual ~BitmapFrameSource();
+
+	virtual bool Open() override;
+	virtual void Close() override;
+	virtual bool Capture(cv::Mat& outFrame, const cv::Rect& region) override;
+
+	virtual cv::Rect GetCaptureRect() const override { return _captureRect; }
+
+protected:
+	IBitmapProvider* _provider;
+	cv::Rect _captureRect;
+	cv::Size _allocatedSize;
+	FramePixelFormat _allocatedFormat = FRAME_FORMAT_BGR;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+// Windows dependencies
+#define NOMINMAX
+#include <windows.h>
+
+// Internal dependencies
+#include <system/frameSources/bitmapFrameSource.h>
+
+// Persistent memory DC with a DIB section that BitBlt writes into directly
+class GdiBitmapProvider : public IBitmapProvider
+{
+public:
+	GdiBitmapProvider(HDC srcHdc) : _srcHdc(srcHdc) {}
+	virtual ~GdiBitmapProvider() { Release(); }
+
+	virtual cv::Size GetSourceSize() override;
+	virtual bool Allocate(const cv::Size& size, FramePixelFormat format) override;
+	virtual void Release() override;
+	virtual bool Grab(const cv::Rect& region) override;
+	virtual PixelBuffer GetPixels() const override { return _pixels; }
+
+private:
+	HDC _srcHdc;
+	HDC _memHdc = nullptr;
+	HBITMAP _dibBitmap = nullptr;
+	HGDIOBJ _oldBitmap = nullptr;
+	PixelBuffer _pixels;
+};
+
+// Captures a monitor through GDI BitBlt
+class GdiFrameSource : public BitmapFrameSource
+{
+public:
+	GdiFrameSource(HDC srcHdc, const char* adapterName);
+	virtual ~GdiFrameSource() = default;
+
+	virtual const char* GetName() override { return "GDI"; }
+};
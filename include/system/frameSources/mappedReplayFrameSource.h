@@ -0,0 +1,79 @@
+#pragma once
+
+// Std dependencies
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Internal dependencies
+#include <system/iframeSource.h>
+#include <system/mappedFile.h>
+#include <system/sessionFormat.h>
+
+enum ReplayTiming
+{
+	// Frames are handed out at the pace they were recorded
+	REPLAY_RECORDED_TIMING = 0,
+	// Frames are handed out as fast as they are requested
+	REPLAY_AS_FAST_AS_POSSIBLE = 1,
+	// A frame is only handed out after Step(), so every recorded frame gets processed
+	REPLAY_STEPPED = 2
+};
+
+// Replays a session recorded by the SessionRecorder straight from a memory mapping,
+// keyframes are handed to the pipeline as views of the mapped file (no copy at all)
+class MappedReplayFrameSource : public IFrameSource
+{
+public:
+	MappedReplayFrameSource(const std::filesystem::path& path, ReplayTiming timing = REPLAY_RECORDED_TIMING, bool loop = false);
+	virtual ~MappedReplayFrameSource() = default;
+
+	virtual bool Open() override;
+	virtual void Close() override;
+	virtual bool Capture(cv::Mat& outFrame, const cv::Rect& region) override;
+	virtual std::shared_ptr<const void> GetFrameOwner() const override { return _lastCaptureIsView ? _file : nullptr; }
+
+	virtual cv::Rect GetCaptureRect() const override { return _captureRect; }
+	virtual const char* GetName() override { return "Mapped Replay"; }
+
+	size_t GetFrameCount() const { return _index.size(); }
+	bool IsFinished() const;
+
+	// Lets the next frame through when replaying with REPLAY_STEPPED
+	void Step();
+	// Cursor position (system coordinates) recorded along with the last captured frame
+	cv::Point GetCursorPosition() const;
+
+private:
+	bool loadIndex();
+	const SessionFrameHeader* getFrameHeader(size_t frameIndex) const;
+	// Payload of a record, through the copy-on-write mapping
+	uint8_t* getRecordedPixels(const SessionFrameHeader* header) const;
+	void applyKeyFrame(const SessionFrameHeader* header);
+	void applyDeltaFrame(const SessionFrameHeader* header);
+
+	std::filesystem::path _path;
+	std::shared_ptr<MappedFile> _file;
+	SessionFileHeader _header = {};
+	std::vector<SessionIndexEntry> _index;
+	ReplayTiming _timing;
+	bool _loop;
+
+	cv::Rect _captureRect;
+	cv::Size _tileGrid;
+	size_t _nextFrame = 0;
+	bool _lastCaptureIsView = false;
+	std::chrono::steady_clock::time_point _playbackStart;
+
+	// Deltas are patched on top of the canvas, keyframes are only copied there once a delta needs them
+	cv::Mat _canvas;
+	const SessionFrameHeader* _pendingKeyFrame = nullptr;
+
+	mutable std::mutex _stepMutex;
+	std::condition_variable _stepCondition;
+	size_t _pendingSteps = 0;
+	cv::Point _cursorPosition;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+// Std dependencies
+#include <filesystem>
+#include <vector>
+
+// Internal dependencies
+#include <system/iframeSource.h>
+
+// Replays an image file, or a directory of images (in name order), as captured frames
+class ReplayFrameSource : public IFrameSource
+{
+public:
+	ReplayFrameSource(const std::filesystem::path& path, bool loop = true);
+	virtual ~ReplayFrameSource() = default;
+
+	virtual bool Open() override;
+	virtual void Close() override;
+	virtual bool Capture(cv::Mat& outFrame, const cv::Rect& region) override;
+
+	virtual cv::Rect GetCaptureRect() const override { return _captureRect; }
+	virtual const char* GetName() override { return "Replay"; }
+
+	size_t GetFrameCount() const { return _framePaths.size(); }
+
+private:
+	std::filesystem::path _path;
+	std::vector<std::filesystem::path> _framePaths;
+	size_t _nextFrame = 0;
+	bool _loop;
+
+	cv::Rect _captureRect;
+	cv::Mat _decodedFrame;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+// Linux dependencies
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+// Std dependencies
+#include <string>
+
+// Internal dependencies
+#include <system/iframeSource.h>
+
+// Captures the root window of an X11 screen through the MIT-SHM extension
+// (works against a virtual framebuffer such as Xvfb as well)
+class X11FrameSource : public IFrameSource
+{
+public:
+	// Empty display name picks the DISPLAY environment variable
+	X11FrameSource(const std::string& displayName = "");
+	virtual ~X11FrameSource();
+
+	virtual bool Open() override;
+	virtual void Close() override;
+	virtual bool Capture(cv::Mat& outFrame, const cv::Rect& region) override;
+
+	virtual cv::Rect GetCaptureRect() const override { return _captureRect; }
+	virtual const char* GetName() override { return "X11 (MIT-SHM)"; }
+
+private:
+	std::string _displayName;
+	cv::Rect _captureRect;
+
+	Display* _display = nullptr;
+	Window _rootWindow = 0;
+	XImage* _image = nullptr;
+	XShmSegmentInfo _shmInfo = {};
+	bool _shmAttached = false;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+// Std dependencies
+#include <memory>
+
+// Third party dependencies
+#include <opencv2/core.hpp>
+
+// Pixel layout of the captured frames
+enum FramePixelFormat
+{
+	// CV_8UC3, what OpenCV (and most of the tasks) expects by default
+	FRAME_FORMAT_BGR = 0,
+	// CV_8UC4, native layout of screen bitmaps, so it needs no repacking and rows stay aligned
+	FRAME_FORMAT_BGRA = 1
+};
+
+// Backend that produces the frames published by the WindowCaptureService
+class IFrameSource
+{
+public:
+	IFrameSource() = default;
+	virtual ~IFrameSource() = default;
+
+	// Called from the capture thread before the first and after the last capture
+	virtual bool Open() = 0;
+	virtual void Close() = 0;
+
+	// Fills the frame with the given region (in frame coordinates), reusing its memory when the size matches
+	virtual bool Capture(cv::Mat& outFrame, const cv::Rect& region) = 0;
+	// Sources that capture into views of their own memory (instead of copying) return what keeps
+	// the last captured frame alive, nullptr otherwise
+	virtual std::shared_ptr<const void> GetFrameOwner() const { return nullptr; }
+
+	// Area covered by the frames, in system (screen) coordinates
+	virtual cv::Rect GetCaptureRect() const = 0;
+	virtual const char* GetName() = 0;
+
+	// Set before the source is opened
+	void SetPixelFormat(FramePixelFormat format) { _pixelFormat = format; }
+	FramePixelFormat GetPixelFormat() const { return _pixelFormat; }
+
+protected:
+	FramePixelFormat _pixelFormat = FRAME_FORMAT_BGR;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+// Std dependencies
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// Read-only memory mapping of a whole file, or a copy-on-write one (writes land in private
+// pages of this process and never reach the file)
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::filesystem::path& path, bool copyOnWrite = false);
+	void Close();
+
+	bool IsOpen() const { return _data != nullptr; }
+	const uint8_t* GetData() const { return _data; }
+	// Only available on copy-on-write mappings (nullptr otherwise)
+	uint8_t* GetWritableData() const { return _copyOnWrite ? _data : nullptr; }
+	size_t GetSize() const { return _size; }
+
+private:
+	uint8_t* _data = nullptr;
+	size_t _size = 0;
+	bool _copyOnWrite = false;
+#ifdef _WIN32
+	void* _file = nullptr;
+	void* _mapping = nullptr;
+#else
+	int _file = -1;
+#endif
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+// Std dependencies
+#include <cstdint>
+
+// Third party dependencies
+#include <opencv2/core.hpp>
+
+// Recorded sessions (.osrsrec) are laid out as:
+//   SessionFileHeader
+//   SessionChunkHeader, followed by chunkBytes worth of frame records, repeated
+//   SessionIndexEntry for every frame record
+//   SessionFileFooter
+// Every frame record is a SessionFrameHeader followed by its payload, and
+// starts at a SESSION_ALIGNMENT boundary so pixels can be read straight from
+// a memory-mapped file. Pixel rows are stored tightly packed (no stride).
+
+enum SessionFrameEncoding
+{
+	// Payload holds every pixel of the frame region
+	SESSION_FRAME_KEY	= 0,
+	// Payload holds the indices (uint32_t, padded to SESSION_ALIGNMENT) of the
+	// tiles that changed since they were last recorded, followed by their pixels
+	SESSION_FRAME_DELTA = 1
+};
+
+static constexpr uint32_t SESSION_VERSION = 1;
+static constexpr uint64_t SESSION_ALIGNMENT = 64;
+static constexpr char SESSION_FILE_MAGIC[8] = { 'O', 'S', 'R', 'S', 'R', 'E', 'C', '1' };
+static constexpr char SESSION_INDEX_MAGIC[8] = { 'O', 'S', 'R', 'S', 'I', 'D', 'X', '1' };
+static constexpr uint32_t SESSION_CHUNK_MAGIC = 0x4B4E4843; // "CHNK"
+
+struct SessionFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t tileSize;
+	int32_t frameWidth;
+	int32_t frameHeight;
+	// Capture origin in system coordinates (cursor positions are in system coordinates)
+	int32_t originX;
+	int32_t originY;
+	// OpenCV pixel type of the frames (e.g. CV_8UC3)
+	int32_t pixelType;
+	uint32_t reserved[7];
+};
+
+struct SessionChunkHeader
+{
+	uint32_t magic;
+	uint32_t frameCount;
+	// Bytes of frame records following this header
+	uint64_t chunkBytes;
+	uint64_t reserved[6];
+};
+
+struct SessionFrameHeader
+{
+	uint64_t sequence;
+	// Capture time in nanoseconds since the recording started
+	int64_t timestamp;
+	int32_t cursorX;
+	int32_t cursorY;
+	int32_t regionX;
+	int32_t regionY;
+	int32_t regionWidth;
+	int32_t regionHeight;
+	uint32_t encoding;
+	uint32_t tileCount;
+	uint64_t payloadBytes;
+	uint64_t reserved;
+};
+
+struct SessionIndexEntry
+{
+	uint64_t sequence;
+	int64_t timestamp;
+	// File offset of the SessionFrameHeader
+	uint64_t offset;
+	uint32_t encoding;
+	uint32_t reserved;
+};
+
+struct SessionFileFooter
+{
+	uint64_t indexOffset;
+	uint64_t indexCount;
+	char magic[8];
+	uint64_t reserved;
+};
+
+static_assert(sizeof(SessionFileHeader) == SESSION_ALIGNMENT, "Session file header must keep records aligned");
+static_assert(sizeof(SessionChunkHeader) == SESSION_ALIGNMENT, "Session chunk header must keep records aligned");
+static_assert(sizeof(SessionFrameHeader) == SESSION_ALIGNMENT, "Session frame header must keep payloads aligned");
+
+inline uint64_t alignSessionOffset(uint64_t offset)
+{
+	return (offset + SESSION_ALIGNMENT - 1) & ~(SESSION_ALIGNMENT - 1);
+}
+
+// Area of a delta tile, tiles on the region borders only hold the pixels inside the region
+inline cv::Rect getSessionTileRect(uint32_t tileIndex, const cv::Size& tileGrid, int tileSize, const cv::Rect& region)
+{
+	const int tileX = tileIndex % tileGrid.width;
+	const int tileY = tileIndex / tileGrid.width;
+	return cv::Rect(tileX * tileSize, tileY * tileSize, tileSize, tileSize) & region;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+// Std dependencies
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Third party dependencies
+#include <opencv2/core.hpp>
+
+// Internal dependencies
+#include <system/framePool.h>
+#include <system/sessionFormat.h>
+
+// Records every published frame (and the cursor position) to a lossless .osrsrec
+// session file, see sessionFormat.h for the layout. Frames are queued by the capture
+// thread and written by a background thread, so disk speed never stalls the capture.
+class SessionRecorder
+{
+  public:
+	SessionRecorder() = default;
+	~SessionRecorder();
+
+	SessionRecorder(const SessionRecorder&) = delete;
+	SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+	// Cursor provider is sampled from the capture thread (system coordinates)
+	bool Start(const std::filesystem::path& path, std::function<cv::Point()> cursorProvider);
+	// Flushes the queued frames and writes the seek index
+	void Stop();
+	bool IsRecording() const { return _recording; }
+	// Set when writing to the file failed (e.g. the disk is full), nothing is written after that and the file has no index
+	bool HasFailed() const { return _failed; }
+
+	// Every Nth frame stores all of its pixels, the others only the tiles that changed
+	// (1 records keyframes only, which can be replayed without any copy)
+	void SetKeyFrameInterval(uint32_t interval) { _keyFrameInterval = std::max(interval, 1u); }
+	// Frames arriving while the queue is full are dropped (and counted), queued frames hold on to pooled
+	// capture buffers, so the queue is bounded by the bytes of pixels too (a slow disk would pin every 4K buffer otherwise)
+	void SetMaxQueuedFrames(size_t maxFrames) { _maxQueuedFrames = std::max(maxFrames, size_t(1)); }
+	void SetMaxQueuedBytes(size_t maxBytes) { _maxQueuedBytes = maxBytes; }
+
+	uint64_t GetRecordedFrames() const { return _recordedFrames; }
+	uint64_t GetDroppedFrames() const { return _droppedFrames; }
+	uint64_t GetWrittenBytes() const { return _writtenBytes; }
+
+  private:
+	struct QueuedFrame
+	{
+		FrameHandle frame;
+		cv::Point cursor;
+		size_t bytes;
+	};
+
+	void onFrame(const FrameHandle& frame);
+	void writerLoop();
+	void writeChunk(const std::vector<QueuedFrame>& frames);
+	void encodeFrame(const QueuedFrame& queued, std::vector<uint8_t>& buffer);
+	void writeIndex();
+	void write(const void* data, size_t size);
+
+	std::ofstream _file;
+	std::thread _writerThread;
+	std::function<cv::Point()> _cursorProvider;
+	int _listenerId = -1;
+
+	std::mutex _queueMutex;
+	std::condition_variable _queueCondition;
+	std::deque<QueuedFrame> _queue;
+	size_t _maxQueuedFrames = 64;
+	size_t _maxQueuedBytes = 128 * 1024 * 1024;
+	size_t _queuedBytes = 0;
+	std::atomic<bool> _recording = false;
+	std::atomic<bool> _failed = false;
+
+	std::atomic<uint32_t> _keyFrameInterval = 30;
+
+	// Only touched by the writer thread
+	uint32_t _framesSinceKeyFrame = 0;
+	bool _headerWritten = false;
+	uint64_t _fileOffset = 0;
+	cv::Size _tileGrid;
+	std::vector<uint64_t> _recordedTileStamps;
+	std::vector<uint32_t> _deltaTiles;
+	std::vector<uint8_t> _chunkBuffer;
+	std::vector<SessionIndexEntry> _index;
+	std::chrono::steady_clock::time_point _startTime;
+
+	std::atomic<uint64_t> _recordedFrames = 0;
+	std::atomic<uint64_t> _droppedFrames = 0;
+	std::atomic<uint64_t> _writtenBytes = 0;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+// Std dependencies
+#include <cstdint>
+#include <vector>
+
+// Third party dependencies
+#include <opencv2/core.hpp>
+
+// Keeps track of the sequence at which each tile of the capture last changed,
+// by comparing every captured region against the last known pixels
+class TileChangeTracker
+{
+  public:
+	TileChangeTracker(int tileSize = 32) : _tileSize(tileSize) {}
+
+	// Stamps the tiles of the region (in frame coordinates) that changed with the sequence
+	void Update(const cv::Mat& image, const cv::Rect& region, const cv::Size& frameSize, uint64_t sequence);
+
+	int GetTileSize() const { return _tileSize; }
+	cv::Size GetTileGrid() const { return _tileGrid; }
+	const std::vector<uint64_t>& GetTileStamps() const { return _tileStamps; }
+
+  private:
+	int _tileSize;
+	cv::Size _tileGrid;
+	std::vector<uint64_t> _tileStamps;
+
+	// Last known pixels of the full capture
+	cv::Mat _reference;
+};
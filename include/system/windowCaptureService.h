@@ -1,17 +1,23 @@
 #pragma once
 
-// Windows dependencies
-#define NOMINMAX
-#include <windows.h>
-
 // Std dependencies
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 
 // Third party dependencies
 #include <opencv2/core.hpp>
 
+// Internal dependencies
+#include <system/framePool.h>
+#include <system/iframeSource.h>
+#include <system/tileChangeTracker.h>
+
 class WindowCaptureService
 {
   public:
@@ -21,11 +27,44 @@ class WindowCaptureService
 		return instance;
 	}
 
-	void StartCapture(HDC srcHdc, const char* adapterName);
+	// Takes ownership of the source, which is deleted when capture stops
+	void StartCapture(IFrameSource* source);
 	void StopCapture();
 	bool IsCapturing() const;
 
-	cv::Mat GetLatestFrame();
+	// Target rate (in Hz) at which frames are captured, 0 captures as fast as possible
+	void SetCaptureRate(uint32_t rate) { _captureRate = rate; }
+
+	// Rate (in Hz) of full frames while regions are subscribed, 0 captures a full frame every tick
+	void SetFullFrameRate(uint32_t rate) { _fullFrameRate = rate; }
+
+	// Pixel layout of the frames, applied when capture starts
+	void SetPixelFormat(FramePixelFormat format) { _pixelFormat = format; }
+	FramePixelFormat GetPixelFormat() const { return _pixelFormat; }
+
+	// Cheap to call, readers share the frame instead of copying it
+	FrameHandle GetLatestFrame();
+	// Blocks until a full frame newer than the given sequence is published or the timeout expires,
+	// always returns the latest frame (check its sequence to know if the wait timed out)
+	FrameHandle WaitForFrameNewerThan(uint64_t sequence, std::chrono::milliseconds timeout);
+
+	// Region of interest subscriptions, the capture only grabs the union of the regions due
+	// at each tick (region in frame coordinates, rate in Hz, 0 captures it every tick)
+	int SubscribeRegion(const cv::Rect& region, uint32_t rate = 0);
+	void UpdateRegion(int subscriptionId, const cv::Rect& region);
+	void UnsubscribeRegion(int subscriptionId);
+	// Latest frame covering the subscribed region (can be a full frame), nullptr if none yet
+	FrameHandle GetLatestRegionFrame(int subscriptionId);
+
+	// Listeners are called from the capture thread for every published frame (full or region),
+	// they must return quickly as they hold up the capture
+	using FrameListener = std::function<void(const FrameHandle&)>;
+	int AddFrameListener(FrameListener listener);
+	void RemoveFrameListener(int listenerId);
+
+	// Amount of pixel data captured in the last second
+	size_t GetCapturedBytesPerSecond() const { return _capturedBytesPerSecond; }
+
 	inline cv::Point SystemToFrameCoordinates(const cv::Point& point, const cv::Mat& frame) const;
 	inline cv::Point FrameToSystemCoordinates(const cv::Point& point, const cv::Mat& frame) const;
 	std::pair<cv::Point, cv::Point> GetCaptureDimensions() const { return { _captureMin, _captureMax }; }
@@ -37,15 +76,36 @@ class WindowCaptureService
 	WindowCaptureService(const WindowCaptureService&) = delete;
 	WindowCaptureService& operator=(const WindowCaptureService&) = delete;
 
-	void captureLoop(HDC srcHdc);
-	void captureScreen(HDC srcHdc, cv::Mat* outMat);
+	void captureLoop();
+
+	struct RegionSubscription
+	{
+		cv::Rect region;
+		uint32_t rate;
+		std::chrono::steady_clock::time_point nextCaptureTime;
+		FrameHandle latestFrame;
+	};
 
 	std::thread _captureThread;
 	std::atomic<bool> _capturing;
 	std::mutex _frameMutex;
-	cv::Mat* _frontFrame;
-	cv::Mat* _backFrame;
-	HDC _srcHdc;
+	std::condition_variable _frameCondition;
+	FramePool _framePool;
+	FramePool _regionFramePool;
+	FrameHandle _latestFrame;
+	uint64_t _frameSequence = 0;
+	std::atomic<uint32_t> _captureRate = 0;
+	std::atomic<uint32_t> _fullFrameRate = 0;
+	FramePixelFormat _pixelFormat = FRAME_FORMAT_BGR;
+	std::chrono::steady_clock::time_point _nextFullFrameTime;
+	std::unordered_map<int, RegionSubscription> _subscriptions;
+	int _nextSubscriptionId = 0;
+	std::atomic<size_t> _capturedBytesPerSecond = 0;
+	TileChangeTracker _changeTracker;
+	std::mutex _listenerMutex;
+	std::unordered_map<int, FrameListener> _listeners;
+	int _nextListenerId = 0;
+	IFrameSource* _source;
 	cv::Point _captureMin, _captureMax;
 };
 
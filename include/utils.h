@@ -1,11 +1,13 @@
 #pragma once
 
+#ifdef _WIN32
 // Avoid symbol conflicts with std::min and std::max
 #define NOMINMAX
 
 // Windows dependencies
 #include <windows.h>
 #include <winnls.h>
+#endif
 
 // Std dependencies
 #include <string>
@@ -28,6 +30,7 @@
 #include <system/mouseMovement.h>
 #include <system/windowCaptureService.h>
 
+#ifdef _WIN32
 // Function to convert wide string to UTF-8
 inline std::string WideStringToUTF8(const std::wstring& wstr)
 {
@@ -47,6 +50,11 @@ inline std::wstring UTF8ToWideString(const std::string& str)
 	MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), &wstrTo[0], size_needed);
 	return wstrTo;
 }
+#else
+// Non Windows builds (e.g. the headless replay runner) rely on the native narrow encoding
+inline std::string WideStringToUTF8(const std::wstring& wstr) { return std::filesystem::path(wstr).string(); }
+inline std::wstring UTF8ToWideString(const std::string& str) { return std::filesystem::path(str).wstring(); }
+#endif
 
 inline void drawWindowTitle(const char* title, ImVec2 windowPos)
 {
@@ -99,9 +107,10 @@ inline void drawScreenView(cv::Mat& _frame, uint32_t _frameTexId)
 	ImGui::Dummy({horPadding, 0});
 	ImGui::SameLine();
 
-	// Upload the image data to the texture
+	// Upload the image data to the texture (BGRA frames upload with 4 byte aligned rows)
 	glBindTexture(GL_TEXTURE_2D, _frameTexId);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, _frame.cols, _frame.rows, 0, GL_BGR, GL_UNSIGNED_BYTE, _frame.data);
+	const GLenum format = _frame.channels() == 4 ? GL_BGRA : GL_BGR;
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, _frame.cols, _frame.rows, 0, format, GL_UNSIGNED_BYTE, _frame.data);
 	ImGui::Image((void*)(intptr_t)_frameTexId, ImVec2(displayWidth, displayHeight));
 
 	// Ensures we cover any remaining space
@@ -172,9 +181,10 @@ inline int drawFilePicker(const char* label, const char* hint, wchar_t*& inOutPa
 		if (result == NFD_OKAY)
 		{
 			if (inOutPath != nullptr) delete[] inOutPath;
-			size_t pathLen = wcslen(outPath) + 1;
+			std::wstring widePath = std::filesystem::path(outPath).wstring();
+			size_t pathLen = widePath.size() + 1;
 			inOutPath = new wchar_t[pathLen];
-			std::memcpy(inOutPath, outPath, pathLen * sizeof(wchar_t));
+			std::memcpy(inOutPath, widePath.c_str(), pathLen * sizeof(wchar_t));
 			NFD::FreePath(outPath);
 		}
 		return result;
@@ -389,11 +399,21 @@ inline void exportDetections(const cv::Mat& frame, const std::vector<DetectionBo
 	std::filesystem::create_directory("screenshots");
 
 	// Save the screenshot
-	std::string screenshotPath = fmt::format("screenshots\\screenshot_{:d}.png", t);
-	cv::imwrite(screenshotPath, frame);
+	// Screen alpha is meaningless, BGRA frames are saved as BGR
+	std::string screenshotPath = fmt::format("screenshots/screenshot_{:d}.png", t);
+	if (frame.channels() == 4)
+	{
+		cv::Mat bgrFrame;
+		cv::cvtColor(frame, bgrFrame, cv::COLOR_BGRA2BGR);
+		cv::imwrite(screenshotPath, bgrFrame);
+	}
+	else
+	{
+		cv::imwrite(screenshotPath, frame);
+	}
 
 	// Save the labels
-	std::string labelsPath = fmt::format("screenshots\\screenshot_{:d}.txt", t);
+	std::string labelsPath = fmt::format("screenshots/screenshot_{:d}.txt", t);
 	std::ofstream file(labelsPath);
 	for (DetectionBox detection : detections)
 	{
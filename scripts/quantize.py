@@ -0,0 +1,82 @@
+"""Static INT8 quantization of the bot's ONNX models.
+
+Calibration tensors are written by the replay runner, through the model's own preprocessing:
+    replay-runner --calibrate models/yolov8s-osrs-ores-v5.onnx screenshots calibration/yolov8s-osrs-ores-v5
+
+Then:
+    python scripts/quantize.py models/yolov8s-osrs-ores-v5.onnx calibration/yolov8s-osrs-ores-v5
+
+writes models/yolov8s-osrs-ores-v5-int8.onnx, which loads like any other model. Compare it against the FP32 one with:
+    replay-runner --evaluate screenshots models/yolov8s-osrs-ores-v5.onnx models/yolov8s-osrs-ores-v5-int8.onnx --cpu
+
+Requires: pip install onnxruntime onnx numpy
+"""
+
+import argparse
+import os
+import sys
+import tempfile
+
+import numpy as np
+import onnx
+from onnxruntime.quantization import CalibrationDataReader, CalibrationMethod, QuantFormat, QuantType, quantize_static
+from onnxruntime.quantization.shape_inference import quant_pre_process
+
+
+class TensorFolderReader(CalibrationDataReader):
+    """Feeds the .npy input tensors of a folder, one batch item at a time."""
+
+    def __init__(self, folder, input_name):
+        self.paths = sorted(os.path.join(folder, name) for name in os.listdir(folder) if name.endswith(".npy"))
+        self.input_name = input_name
+        self.index = 0
+
+    def get_next(self):
+        if self.index >= len(self.paths):
+            return None
+        tensor = np.load(self.paths[self.index]).astype(np.float32)
+        self.index += 1
+        return {self.input_name: tensor}
+
+    def rewind(self):
+        self.index = 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Static INT8 quantization with calibration tensors exported by the replay runner")
+    parser.add_argument("model", help="FP32 ONNX model")
+    parser.add_argument("calibration", help="Folder of .npy input tensors (replay-runner --calibrate)")
+    parser.add_argument("--output", help="Quantized model path (default: <model>-int8.onnx next to the model)")
+    parser.add_argument("--method", choices=["minmax", "entropy", "percentile"], default="minmax", help="Calibration method")
+    parser.add_argument("--format", choices=["qdq", "qoperator"], default="qdq", help="QDQ keeps the graph portable, ORT fuses it on load")
+    parser.add_argument("--per-channel", action="store_true", help="Per channel weight scales, usually recovers accuracy on convolutions")
+    parser.add_argument("--reduce-range", action="store_true", help="7 bit weights, for CPUs without VNNI where 8 bit can saturate")
+    parser.add_argument("--exclude", nargs="*", default=[], help="Node names kept in FP32 (e.g. the detection head)")
+    args = parser.parse_args()
+
+    output = args.output or os.path.splitext(args.model)[0] + "-int8.onnx"
+    input_name = onnx.load(args.model, load_external_data=False).graph.input[0].name
+    reader = TensorFolderReader(args.calibration, input_name)
+    if not reader.paths:
+        print(f"No calibration tensors found in '{args.calibration}'")
+        return 1
+
+    methods = {"minmax": CalibrationMethod.MinMax, "entropy": CalibrationMethod.Entropy, "percentile": CalibrationMethod.Percentile}
+    formats = {"qdq": QuantFormat.QDQ, "qoperator": QuantFormat.QOperator}
+
+    # Shape inference and graph cleanup first, as recommended before static quantization
+    with tempfile.TemporaryDirectory() as folder:
+        prepared = os.path.join(folder, "prepared.onnx")
+        quant_pre_process(args.model, prepared)
+
+        print(f"Calibrating on {len(reader.paths)} tensors ({args.method}, {args.format})")
+        quantize_static(prepared, output, reader, quant_format=formats[args.format], activation_type=QuantType.QUInt8,
+                        weight_type=QuantType.QInt8, per_channel=args.per_channel, reduce_range=args.reduce_range,
+                        calibrate_method=methods[args.method], nodes_to_exclude=args.exclude)
+
+    print(f"Wrote {output} ({os.path.getsize(args.model) / 2**20:.1f} MB -> {os.path.getsize(output) / 2**20:.1f} MB)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,6 +1,7 @@
 #include <bot/botManagerWindow.h>
 
 // Std dependencies
+#include <chrono>
 #include <string>
 
 // Third party dependencies
@@ -46,28 +47,46 @@ BotManagerWindow::~BotManagerWindow()
 
 void BotManagerWindow::Run(float deltaTime)
 {
-	// Clear resource manager for frame
-	ResourceManager& resourceManager = ResourceManager::GetInstance();
-	resourceManager.RemoveAllResources();
+	// Only process frames we haven't seen yet, accumulating the time in between
+	_pendingDeltaTime += deltaTime;
+	FrameHandle frameHandle = _captureService.GetLatestFrame();
+	const bool isNewFrame = _frameHandle == nullptr || frameHandle->sequence != _frameHandle->sequence;
+	if (isNewFrame)
+	{
+		deltaTime = _pendingDeltaTime;
+		_pendingDeltaTime = 0.0f;
+
+		// Clear resource manager for frame
+		ResourceManager& resourceManager = ResourceManager::GetInstance();
+		resourceManager.RemoveAllResources();
 
-	// Fetch a new copy of the image
-	_frame = _captureService.GetLatestFrame();
+		// Fetch the latest frame, tasks draw on top of a scratch copy (its buffer is reused, so this doesn't allocate)
+		_frameHandle = frameHandle;
+		if (_isBotRunning)
+		{
+			_frameHandle->image.copyTo(_drawFrame);
+			_frame = _drawFrame;
+		}
+		else
+		{
+			_frame = _frameHandle->image;
+		}
 
-	// Set frame on resource manager
-	resourceManager.SetResource("Main Frame", &_frame);
+		// Set frame on resource manager
+		resourceManager.SetResource("Main Frame", &_frame);
+		resourceManager.SetResource("Main Frame Handle", &_frameHandle);
+	}
 
-	if (_isBotRunning)
+	// Tasks are only ran for new frames
+	if (_isBotRunning && isNewFrame)
 	{
 		if (!_mouseMovementDatabase.IsLoaded())
 		{
 			_mouseMovementDatabase.LoadMovements();
 		}
 
-		// Run tasks
-		for (auto task : _tasks)
-		{
-			task->Run(deltaTime);
-		}
+		// Run tasks (those whose inputs didn't change republish their last outputs)
+		_taskScheduler.Run(_tasks, deltaTime);
 
 		// Draw cursor
 		cv::Point mousePos;
@@ -96,6 +115,66 @@ void BotManagerWindow::Run(float deltaTime)
 
 				ImGui::TextWrapped("Use this panel to configure the bot's tasks.");
 
+				ImGui::SeparatorText("Capture");
+				ImGui::TextUnformatted("Full Frame Rate:");
+				ImGui::SameLine();
+				ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+				if (ImGui::SliderInt("##fullFrameRate", &_fullFrameRate, 0, 60, _fullFrameRate == 0 ? "Every capture" : "%d Hz"))
+				{
+					_captureService.SetFullFrameRate(_fullFrameRate);
+				}
+				ImGui::Text("Captured Data: %.2f MB/s", _captureService.GetCapturedBytesPerSecond() / (1024.0f * 1024.0f));
+
+				if (!_sessionRecorder.IsRecording())
+				{
+					if (ImGui::Button("Record Session"))
+					{
+						const auto now = std::chrono::system_clock::now().time_since_epoch();
+						const std::string sessionPath = fmt::format("sessions/session_{}.osrsrec", std::chrono::duration_cast<std::chrono::seconds>(now).count());
+						_sessionRecorder.Start(sessionPath, [this]()
+						{
+							cv::Point cursor;
+							_inputManager.GetMousePosition(cursor);
+							return cursor;
+						});
+					}
+				}
+				else if (ImGui::Button("Stop Recording"))
+				{
+					_sessionRecorder.Stop();
+				}
+				if (_sessionRecorder.HasFailed())
+				{
+					// Writing failed, the recorder doesn't take frames anymore
+					if (_sessionRecorder.IsRecording()) _sessionRecorder.Stop();
+					ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Recording failed, could not write to the session file!");
+				}
+				if (_sessionRecorder.GetRecordedFrames() > 0)
+				{
+					ImGui::Text("Recorded: %llu frames (%llu dropped), %.2f MB", _sessionRecorder.GetRecordedFrames(), _sessionRecorder.GetDroppedFrames(),
+								_sessionRecorder.GetWrittenBytes() / (1024.0f * 1024.0f));
+				}
+
+				ImGui::SeparatorText("Scheduler");
+				bool motionGating = _taskScheduler.IsMotionGating();
+				if (ImGui::Checkbox("Motion Gating", &motionGating))
+				{
+					_taskScheduler.SetMotionGating(motionGating);
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("Reset Stats"))
+				{
+					_taskScheduler.ResetStats();
+				}
+				for (auto task : _tasks)
+				{
+					const TaskRunStats stats = _taskScheduler.GetStats(task);
+					ImGui::Text("%s: %zu ran, %zu skipped (%.0f%%), %.1f ms saved", task->GetName(), stats.executedCount, stats.skippedCount,
+								stats.GetSkipRatio() * 100.0f, stats.GetSavedTime());
+				}
+				const TaskRunStats totalStats = _taskScheduler.GetTotalStats();
+				ImGui::Text("Total: %.0f%% skipped, %.1f ms saved", totalStats.GetSkipRatio() * 100.0f, totalStats.GetSavedTime());
+
 				ImGui::Separator();
 				if (ImGui::Button("Add Task"))
 				{
@@ -153,6 +232,7 @@ void BotManagerWindow::Run(float deltaTime)
 
 							// Set state accordingly
 							_isBotRunning = sucess;
+							_taskScheduler.Invalidate();
 							_inputManager.SetCapsLock(sucess);
 						}
 					}
@@ -0,0 +1,110 @@
+#include <bot/taskScheduler.h>
+
+// Std dependencies
+#include <chrono>
+
+void InputSignature::AddRegion(const Frame& frame, const cv::Rect& rect)
+{
+	Add(rect);
+	if (frame.tileSize > 0)
+	{
+		Add(frame.GetLastChange(rect));
+	}
+	else if (frame.Covers(rect))
+	{
+		AddImage(frame.View(rect));
+	}
+	else
+	{
+		// Nothing to compare against, always different
+		Add(frame.sequence);
+	}
+}
+
+void InputSignature::AddImage(const cv::Mat& image)
+{
+	Add(image.cols);
+	Add(image.rows);
+	Add(image.type());
+
+	// Row by row, views into larger images aren't continuous
+	const size_t rowBytes = image.cols * image.elemSize();
+	for (int y = 0; y < image.rows; ++y)
+	{
+		const uint8_t* row = image.ptr<uint8_t>(y);
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= rowBytes; i += sizeof(uint64_t))
+		{
+			uint64_t word;
+			std::memcpy(&word, row + i, sizeof(word));
+			Add(word);
+		}
+		for (; i < rowBytes; ++i)
+		{
+			Add((uint64_t)row[i]);
+		}
+	}
+}
+
+void TaskScheduler::Run(const std::vector<IBotTask*>& tasks, float deltaTime)
+{
+	for (IBotTask* task : tasks)
+	{
+		TaskState& state = _states[task];
+
+		// Compare what the task is about to read against its last run
+		const auto start = std::chrono::steady_clock::now();
+		InputSignature signature;
+		const bool hasSignature = _motionGating && task->GetInputSignature(signature);
+		if (hasSignature && state.hasSignature && signature.Get() == state.signature)
+		{
+			task->Republish(deltaTime);
+			state.stats.overheadTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			++state.stats.skippedCount;
+			continue;
+		}
+
+		const auto runStart = std::chrono::steady_clock::now();
+		task->Run(deltaTime);
+		const auto runEnd = std::chrono::steady_clock::now();
+
+		// The signature was taken before running, anything changed meanwhile shows up next time
+		state.signature = signature.Get();
+		state.hasSignature = hasSignature;
+		state.stats.overheadTime += std::chrono::duration<double, std::milli>(runStart - start).count();
+		state.stats.executedTime += std::chrono::duration<double, std::milli>(runEnd - runStart).count();
+		++state.stats.executedCount;
+	}
+}
+
+void TaskScheduler::Invalidate()
+{
+	for (auto& entry : _states)
+	{
+		entry.second.hasSignature = false;
+	}
+}
+
+TaskRunStats TaskScheduler::GetStats(IBotTask* task) const
+{
+	auto it = _states.find(task);
+	return it != _states.end() ? it->second.stats : TaskRunStats();
+}
+
+TaskRunStats TaskScheduler::GetTotalStats() const
+{
+	TaskRunStats total;
+	for (const auto& entry : _states)
+	{
+		total.Accumulate(entry.second.stats);
+	}
+	return total;
+}
+
+void TaskScheduler::ResetStats()
+{
+	for (auto& entry : _states)
+	{
+		entry.second.stats = TaskRunStats();
+	}
+}
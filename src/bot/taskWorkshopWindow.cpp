@@ -128,8 +128,9 @@ void TaskWorkshopWindow::Run(float deltaTime)
 
 	if (ImGui::Begin("Tasks", nullptr, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse))
 	{
-		// Fetch a new copy of the image
-		_frame = _captureService.GetLatestFrame();
+		// Fetch the latest frame (read-only, nothing is drawn on top of it)
+		_frameHandle = _captureService.GetLatestFrame();
+		_frame = _frameHandle->image;
 
 		ImGui::SeparatorText("This is the Task Workshop! Use it to create and test new tasks.");
 		if (ImGui::BeginTable("##taskWorkshopTable", 3, ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_Resizable))
@@ -1,6 +1,8 @@
 #include <bot/tasks/findTabTask.h>
 
 // Std dependencies
+#include <chrono>
+#include <cstdio>
 #include <vector>
 
 // Third party dependencies
@@ -14,13 +16,22 @@
 #include <system/windowCaptureService.h>
 #include <system/resourceManager.h>
 #include <ml/onnxruntimeInference.h>
+#include <bot/taskScheduler.h>
 #include <utils.h>
 
+// Single channel copy of a BGR(A) image, templates are matched on intensity only
+static void toGray(const cv::Mat& image, cv::Mat& gray)
+{
+	if (image.channels() == 4) cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+	else if (image.channels() == 3) cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+	else image.copyTo(gray);
+}
+
 FindTabTask::FindTabTask()
 {
 	// Set the default model path
-	// const wchar_t* defaultModelPath = L"..\\..\\models\\yolov8s-osrs-tabs-v1.onnx";
-	const wchar_t* defaultModelPath = L"..\\..\\models\\rf-detr-osrs-tabs-1k-v1.onnx";
+	// const wchar_t* defaultModelPath = L"../../models/yolov8s-osrs-tabs-v1.onnx";
+	const wchar_t* defaultModelPath = L"../../models/rf-detr-osrs-tabs-1k-v1.onnx";
 	const size_t len = wcslen(defaultModelPath) + 1;
 	_modelPath = new wchar_t[len];
 	std::memcpy(_modelPath, defaultModelPath, len * sizeof(wchar_t));
@@ -28,6 +39,13 @@ FindTabTask::FindTabTask()
 
 FindTabTask::~FindTabTask()
 {
+	if (_tabSubscription != -1)
+	{
+		WindowCaptureService::GetInstance().UnsubscribeRegion(_tabSubscription);
+	}
+
+	// The worker must be done with the model before it goes away
+	_executor.SetModel(nullptr);
 	if (_model != nullptr)
 	{
 		delete _model;
@@ -36,57 +54,163 @@ FindTabTask::~FindTabTask()
 	delete[] _modelPath;
 }
 
+void FindTabTask::SetModelPath(const std::wstring& modelPath)
+{
+	delete[] _modelPath;
+	_modelPath = new wchar_t[modelPath.size() + 1];
+	std::memcpy(_modelPath, modelPath.c_str(), (modelPath.size() + 1) * sizeof(wchar_t));
+}
+
+void FindTabTask::SetTiling(bool enabled, const TilingConfig& config)
+{
+	_tiledInference = enabled;
+	_tilingConfig = config;
+	_executor.SetTiling(enabled, config);
+
+	// Detections of the previous setup are redone
+	_inferenceConfidenceThreshold = -1.0f;
+}
+
 bool FindTabTask::Load()
 {
 	if (_modelPath == nullptr) return false;
 
-	// Load the model
+	// The model is still resident from the previous start
+	if (_model != nullptr && _loadedModelPath == _modelPath && _loadedUseCuda == _useCuda) return true;
+
+	// Load the model (sessions are shared through the ModelRegistry, the previous model is released)
+	_executor.SetModel(nullptr);
+	delete _model;
 	// _model = new YOLOv8(8, _confidenceThreshold);
 	_model = new RF_DETR(8, _confidenceThreshold);
-	_model->LoadModel(true, _modelPath);
+	bool loaded = _model->LoadModel(_useCuda, _modelPath);
+	if (!loaded && _useCuda)
+	{
+		// CPU only runtimes can't append the CUDA provider, the CPU also gets the profiles tuned for this machine
+		printf("CUDA unavailable, loading the model on the CPU\n");
+		delete _model;
+		_model = new RF_DETR(8, _confidenceThreshold);
+		loaded = _model->LoadModel(false, _modelPath);
+	}
+	if (!loaded)
+	{
+		delete _model;
+		_model = nullptr;
+		_loadedModelPath.clear();
+		return false;
+	}
+	_loadedModelPath = _modelPath;
+	_loadedUseCuda = _useCuda;
+	_inferenceSequence = 0;
+	_tabTemplates.clear();
 
 	// Run a warm-up inference
-	cv::Mat frame = WindowCaptureService::GetInstance().GetLatestFrame();
+	FrameHandle frameHandle = WindowCaptureService::GetInstance().GetLatestFrame();
+	cv::Mat frame = frameHandle->image;
 	_model->Inference(frame, _detectedTabs);
+	_executor.SetModel(_model);
 
 	return true;
 }
 
 void FindTabTask::Run(float deltaTime)
 {
+	auto& resourceManager = ResourceManager::GetInstance();
+
+	_timeSinceDetection += deltaTime;
+
 	// Fetch a new copy of the image (can't have any drawing on it)
 	cv::Mat* frame;
-	ResourceManager::GetInstance().TryGetResource("Main Frame", frame);
+	resourceManager.TryGetResource("Main Frame", frame);
 
-	// Update model params
-	_model->SetConfidenceThreshold(_confidenceThreshold);
+	// The frame handle tells us which parts of the screen changed
+	FrameHandle* frameHandle = nullptr;
+	resourceManager.TryGetResource("Main Frame Handle", frameHandle);
 
-	// Run inference
-	_model->Inference(*frame, _detectedTabs);
+	// Skip inference when nothing changed where the tabs were last found
+	bool shouldInfer = _detectedTabs.empty() || frameHandle == nullptr || _confidenceThreshold != _inferenceConfidenceThreshold;
+	if (!shouldInfer)
+	{
+		cv::Rect tabsArea;
+		for (const auto& tab : _detectedTabs)
+		{
+			tabsArea |= cv::Rect(tab.x, tab.y, tab.w, tab.h);
+		}
+		shouldInfer = (*frameHandle)->HasChangedSince(tabsArea, _inferenceSequence);
+	}
+
+	// Frames already handed to the executor don't need to go through the model again
+	if (shouldInfer && _asyncInference && frameHandle != nullptr && (*frameHandle)->sequence == _inferenceSequence &&
+		_confidenceThreshold == _inferenceConfidenceThreshold)
+	{
+		shouldInfer = false;
+	}
 
-	// Filter out the detections that overlap
-	size_t detectionCount = _detectedTabs.size();
-	for (int i = 0; i < detectionCount; ++i)
+	// Pick up the latest async inference, it is tagged with the frame it ran on
+	bool hasNewDetections = false;
+	uint64_t detectionSequence = 0;
+	if (_executor.TakeLatestResult(_inferenceResult))
 	{
-		DetectionBox& curBox = _detectedTabs[i];
-		for (int j = i + 1; j < _detectedTabs.size(); j++)
+		_detectedTabs.swap(_inferenceResult.detections);
+		detectionSequence = _inferenceResult.sequence;
+		hasNewDetections = true;
+	}
+
+	// Tabs barely move once found, verifying them against their templates is enough until the refresh is due
+	if (shouldInfer && !hasNewDetections && _templateTracking && frameHandle != nullptr && *frameHandle != nullptr && !_tabTemplates.empty() &&
+		_timeSinceDetection < _trackingRefreshInterval && _confidenceThreshold == _inferenceConfidenceThreshold)
+	{
+		if (verifyTemplates(**frameHandle))
 		{
-			DetectionBox& otherBox = _detectedTabs[j];
-			if (curBox.IsSimilar(otherBox, 0.95f))
-			{
-				// Skip if class is different
-				if (curBox.classId != otherBox.classId) continue;
+			_inferenceSequence = (*frameHandle)->sequence;
+			shouldInfer = false;
+		}
+		else
+		{
+			_tabTemplates.clear();
+		}
+	}
 
-				// Merge the two detections in current
-				curBox = curBox.Merge(otherBox);
+	if (shouldInfer)
+	{
+		// Update model params
+		_inferenceConfidenceThreshold = _confidenceThreshold;
+		_inferenceSequence = frameHandle != nullptr ? (*frameHandle)->sequence : 0;
+
+		// Run inference, on a downscaled level of the frame when the model input is smaller
+		if (frameHandle != nullptr && !(*frameHandle)->image.empty() && _asyncInference)
+		{
+			_executor.SubmitLatest(*frameHandle, (*frameHandle)->region, _confidenceThreshold);
+		}
+		else if (frameHandle != nullptr && !(*frameHandle)->image.empty())
+		{
+			_executor.RunNow(*frameHandle, (*frameHandle)->region, _confidenceThreshold, _detectedTabs);
+			detectionSequence = _inferenceSequence;
+			hasNewDetections = true;
+		}
+		else
+		{
+			// The executor might still be using the model
+			_executor.WaitIdle();
+			_model->SetConfidenceThreshold(_confidenceThreshold);
+			_model->Inference(*frame, _detectedTabs);
+			detectionSequence = _inferenceSequence;
+			hasNewDetections = true;
+		}
+	}
 
-				// Swap with last and pop
-				_detectedTabs[j] = _detectedTabs.back();
-				_detectedTabs.pop_back();
+	if (hasNewDetections)
+	{
+		// Merge (or suppress) the detections that overlap
+		_postProcessor.Process(_detectedTabs);
 
-				// Prevent j increment to check the new box
-				--j;
-			}
+		// Templates for the tracking, taken from the frame the model ran on
+		++_detectionCount;
+		_timeSinceDetection = 0.0f;
+		_tabTemplates.clear();
+		if (_templateTracking && frameHandle != nullptr && *frameHandle != nullptr)
+		{
+			updateTemplates(**frameHandle, detectionSequence);
 		}
 	}
 
@@ -105,29 +229,172 @@ void FindTabTask::Run(float deltaTime)
 		return;
 	}
 
+	publish(*frame, frameHandle);
+}
+
+bool FindTabTask::GetInputSignature(InputSignature& signature)
+{
+	// Detections still to come (or to export) need a Run
+	if (_detectedTabs.empty() || _exportDetection || _executor.HasPending() || _executor.HasLatestResult()) return false;
+
+	FrameHandle* frameHandle = nullptr;
+	if (!ResourceManager::GetInstance().TryGetResource("Main Frame Handle", frameHandle) || frameHandle == nullptr || *frameHandle == nullptr)
+	{
+		return false;
+	}
+
+	// Where the tabs were found, Run infers again when any of it changes
+	cv::Rect tabsArea;
+	for (const auto& tab : _detectedTabs)
+	{
+		tabsArea |= cv::Rect(tab.x, tab.y, tab.w, tab.h);
+	}
+	signature.AddRegion(**frameHandle, tabsArea);
+
+	// The tab frame is refreshed from its region subscription in between full frames
+	if (_tabSubscription != -1)
+	{
+		FrameHandle tabFrameHandle = WindowCaptureService::GetInstance().GetLatestRegionFrame(_tabSubscription);
+		if (tabFrameHandle != nullptr) signature.AddRegion(*tabFrameHandle, _tabRegion.rect);
+	}
+
+	signature.Add(_confidenceThreshold);
+	signature.Add((int)_postProcessor.GetConfig().mode);
+	signature.Add(_asyncInference);
+	signature.Add(_tiledInference);
+	signature.Add(_tilingConfig.tileSize);
+	signature.Add(_tilingConfig.overlap);
+	signature.Add((int)_tilingConfig.selection);
+	signature.Add(_templateTracking);
+	signature.Add((int)_trackingTab);
+	signature.Add(_shouldOverrideClass);
+	signature.Add((int)_overrideClass);
+	return true;
+}
+
+void FindTabTask::Republish(float deltaTime)
+{
+	_timeSinceDetection += deltaTime;
+
+	auto& resourceManager = ResourceManager::GetInstance();
+
+	cv::Mat* frame = nullptr;
+	FrameHandle* frameHandle = nullptr;
+	if (!resourceManager.TryGetResource("Main Frame", frame)) return;
+	resourceManager.TryGetResource("Main Frame Handle", frameHandle);
+	publish(*frame, frameHandle);
+}
+
+void FindTabTask::updateTemplates(const Frame& frame, uint64_t detectionSequence)
+{
+	for (const auto& tab : _detectedTabs)
+	{
+		// Tabs cut by the frame, or that changed since the model saw them (async results come in late), aren't tracked
+		const cv::Rect tabRect(tab.x, tab.y, tab.w, tab.h);
+		if (!frame.Covers(tabRect) || (detectionSequence != frame.sequence && frame.HasChangedSince(tabRect, detectionSequence)))
+		{
+			_tabTemplates.clear();
+			return;
+		}
+
+		_tabTemplates.emplace_back();
+		toGray(frame.View(tabRect), _tabTemplates.back());
+	}
+}
+
+bool FindTabTask::verifyTemplates(const Frame& frame)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	// Every tab must still be found around where it was, otherwise the model runs again
+	_trackedPositions.resize(_tabTemplates.size());
+	bool verified = _tabTemplates.size() == _detectedTabs.size();
+	for (size_t i = 0; verified && i < _tabTemplates.size(); ++i)
+	{
+		const DetectionBox& tab = _detectedTabs[i];
+		const cv::Mat& tabTemplate = _tabTemplates[i];
+		const cv::Rect window = cv::Rect(tab.x - _trackingSearchMargin, tab.y - _trackingSearchMargin, tab.w + 2 * _trackingSearchMargin,
+										 tab.h + 2 * _trackingSearchMargin) & frame.region;
+		if (window.width < tabTemplate.cols || window.height < tabTemplate.rows)
+		{
+			verified = false;
+			break;
+		}
+
+		// Zero mean normalized cross correlation, insensitive to brightness changes (hover highlights, fades)
+		toGray(frame.View(window), _searchWindow);
+		cv::matchTemplate(_searchWindow, tabTemplate, _matchScores, cv::TM_CCOEFF_NORMED);
+		double maxScore = 0.0;
+		cv::Point maxLocation;
+		cv::minMaxLoc(_matchScores, nullptr, &maxScore, nullptr, &maxLocation);
+		verified = maxScore >= _trackingMinScore;
+		_trackedPositions[i] = window.tl() + maxLocation;
+	}
+
+	if (verified)
+	{
+		for (size_t i = 0; i < _detectedTabs.size(); ++i)
+		{
+			_detectedTabs[i].x = (float)_trackedPositions[i].x;
+			_detectedTabs[i].y = (float)_trackedPositions[i].y;
+		}
+		++_trackedCount;
+	}
+	_lastTrackingTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return verified;
+}
+
+void FindTabTask::publish(cv::Mat& frame, FrameHandle* frameHandle)
+{
+	auto& resourceManager = ResourceManager::GetInstance();
+
 	// Find the tab we are tracking
+	WindowCaptureService& captureService = WindowCaptureService::GetInstance();
 	for (const auto& tab : _detectedTabs)
 	{
 		cv::Scalar color = cv::Scalar(130, 130, 130);
 		if (tab.classId == _trackingTab)
 		{
-			// Extract the tab frame
-			_tabFrame = (*frame)(cv::Rect(tab.x, tab.y, tab.w, tab.h)).clone();
+			cv::Rect tabRect = cv::Rect(tab.x, tab.y, tab.w, tab.h) & cv::Rect(0, 0, frame.cols, frame.rows);
+
+			// Keep a capture subscription on the tab, so it can be refreshed without full frames
+			if (_tabSubscription == -1)
+			{
+				_tabSubscription = captureService.SubscribeRegion(tabRect);
+			}
+			else
+			{
+				captureService.UpdateRegion(_tabSubscription, tabRect);
+			}
+
+			// Extract the tab frame (from the freshest capture that covers it)
+			FrameHandle tabFrameHandle = captureService.GetLatestRegionFrame(_tabSubscription);
+			if (tabFrameHandle == nullptr || !tabFrameHandle->Covers(tabRect))
+			{
+				tabFrameHandle = frameHandle != nullptr ? *frameHandle : nullptr;
+			}
+			if (tabFrameHandle != nullptr && tabFrameHandle->Covers(tabRect))
+			{
+				_tabFrame = tabFrameHandle->View(tabRect).clone();
+				_tabRegion = { tabFrameHandle, tabRect };
+			}
 			color = cv::Scalar(255, 255, 255);
 		}
 
-		cv::rectangle(*frame, cv::Rect(tab.x, tab.y, tab.w, tab.h), color, 2);
-		cv::putText(*frame, fmt::format("{}", TabNames[tab.classId]), cv::Point(tab.x, tab.y - 5), cv::HersheyFonts::FONT_HERSHEY_PLAIN, 1.0, color, 2);
+		cv::rectangle(frame, cv::Rect(tab.x, tab.y, tab.w, tab.h), color, 2);
+		cv::putText(frame, fmt::format("{}", TabNames[tab.classId]), cv::Point(tab.x, tab.y - 5), cv::HersheyFonts::FONT_HERSHEY_PLAIN, 1.0, color, 2);
 	}
 
-	// Set the output resource
+	// Set the output resources
 	if (_tabFrame.empty())
 	{
-		ResourceManager::GetInstance().RemoveResource(TabNames[_trackingTab]);
+		resourceManager.RemoveResource(TabNames[_trackingTab]);
+		resourceManager.RemoveResource(getTabRegionResource(_trackingTab));
 	}
 	else
 	{
-		ResourceManager::GetInstance().SetResource(TabNames[_trackingTab], &_tabFrame);
+		resourceManager.SetResource(TabNames[_trackingTab], &_tabFrame);
+		resourceManager.SetResource(getTabRegionResource(_trackingTab), &_tabRegion);
 	}
 }
 
@@ -147,10 +414,81 @@ void FindTabTask::Draw()
 	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
 	ImGui::SliderFloat("##confidenceThreshold", &_confidenceThreshold, 0.05f, 1.0f);
 
+	ImGui::TextUnformatted("Post Processing:");
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+	int postProcessMode = _postProcessor.GetConfig().mode;
+	if (ImGui::Combo("##postProcessMode", &postProcessMode, PostProcessModeNames, IM_ARRAYSIZE(PostProcessModeNames)))
+	{
+		_postProcessor.SetMode((PostProcessMode)postProcessMode);
+	}
+
+	ImGui::Checkbox("Use CUDA", &_useCuda);
+	ImGui::SetItemTooltip("Applied on the next start, falls back to the CPU when CUDA isn't available");
+	ImGui::Checkbox("Async Inference", &_asyncInference);
+	if (_asyncInference)
+	{
+		ImGui::SameLine();
+		ImGui::Text("%zu done, %zu dropped, %.1f ms", _executor.GetCompletedCount(), _executor.GetDroppedCount(), _executor.GetLastLatency());
+	}
+
+	// ===================================== //
+	// Tiling Configuration                  //
+	// ===================================== //
+	ImGui::SeparatorText("Tiling Configuration");
+	bool tiledInference = _tiledInference;
+	bool tilingChanged = ImGui::Checkbox("Tiled Inference", &tiledInference);
+	ImGui::BeginDisabled(!tiledInference);
+	ImGui::TextUnformatted("Tile Size:");
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+	// Applied once the slider is released, changing the tiling waits for the running inference
+	ImGui::SliderInt("##tileSize", &_tilingConfig.tileSize, 0, 1280, _tilingConfig.tileSize == 0 ? "Model input" : "%d px");
+	tilingChanged |= ImGui::IsItemDeactivatedAfterEdit();
+	ImGui::TextUnformatted("Tile Overlap:");
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+	ImGui::SliderFloat("##tileOverlap", &_tilingConfig.overlap, 0.0f, 0.5f);
+	tilingChanged |= ImGui::IsItemDeactivatedAfterEdit();
+	ImGui::TextUnformatted("Tile Selection:");
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+	int tileSelection = _tilingConfig.selection;
+	if (ImGui::Combo("##tileSelection", &tileSelection, TileSelectionNames, IM_ARRAYSIZE(TileSelectionNames)))
+	{
+		_tilingConfig.selection = (TileSelection)tileSelection;
+		tilingChanged = true;
+	}
+	ImGui::EndDisabled();
+	if (tilingChanged)
+	{
+		SetTiling(tiledInference, _tilingConfig);
+	}
+
 	// ===================================== //
 	// Tracking Configuration                //
 	// ===================================== //
 	ImGui::SeparatorText("Tracking Configuration");
+	if (ImGui::Checkbox("Template Tracking", &_templateTracking) && !_templateTracking)
+	{
+		_tabTemplates.clear();
+	}
+	ImGui::BeginDisabled(!_templateTracking);
+	ImGui::TextUnformatted("Refresh Interval:");
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+	ImGui::SliderFloat("##trackingRefreshInterval", &_trackingRefreshInterval, 0.5f, 60.0f, "%.1f s");
+	ImGui::TextUnformatted("Min Match Score:");
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+	ImGui::SliderFloat("##trackingMinScore", &_trackingMinScore, 0.5f, 1.0f);
+	ImGui::TextUnformatted("Search Margin:");
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+	ImGui::SliderInt("##trackingSearchMargin", &_trackingSearchMargin, 1, 32, "%d px");
+	ImGui::Text("%zu tracked, %zu detected, %.3f ms", _trackedCount, _detectionCount, _lastTrackingTime);
+	ImGui::EndDisabled();
+
     ImGui::TextUnformatted("Tracking Tab:");
     ImGui::SameLine();
 	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
@@ -202,4 +540,5 @@ void FindTabTask::Draw()
 void FindTabTask::GetOutputResources(std::vector<std::string>& resources)
 {
 	resources.push_back(TabNames[_trackingTab]);
+	resources.push_back(getTabRegionResource(_trackingTab));
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include <bot/tasks/inventoryDropTask.h>
 
+// Std dependencies
+#include <cstdio>
+
 // Third party dependencies
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
@@ -8,12 +11,13 @@
 // Internal dependencies
 #include <system/resourceManager.h>
 #include <bot/tasks/findTabTask.h>
+#include <bot/taskScheduler.h>
 #include <utils.h>
 
 InventoryDropTask::InventoryDropTask()
 {
 	// Set the default model path
-	const wchar_t* defaultModelPath = L"..\\..\\models\\yolov8s-osrs-inventory-ores-v1.onnx";
+	const wchar_t* defaultModelPath = L"../../models/yolov8s-osrs-inventory-ores-v1.onnx";
 	const size_t len = wcslen(defaultModelPath) + 1;
 	_modelPath = new wchar_t[len];
 	std::memcpy(_modelPath, defaultModelPath, len * sizeof(wchar_t));
@@ -21,6 +25,8 @@ InventoryDropTask::InventoryDropTask()
 
 InventoryDropTask::~InventoryDropTask()
 {
+	// The worker must be done with the model before it goes away
+	_executor.SetModel(nullptr);
 	if (_model != nullptr)
 	{
 		delete _model;
@@ -29,17 +35,49 @@ InventoryDropTask::~InventoryDropTask()
 	delete[] _modelPath;
 }
 
+void InventoryDropTask::SetModelPath(const std::wstring& modelPath)
+{
+	delete[] _modelPath;
+	_modelPath = new wchar_t[modelPath.size() + 1];
+	std::memcpy(_modelPath, modelPath.c_str(), (modelPath.size() + 1) * sizeof(wchar_t));
+}
+
 bool InventoryDropTask::Load()
 {
 	if (_modelPath == nullptr) return false;
 
-	// Load the model
+	// The model is still resident from the previous start
+	if (_model != nullptr && _loadedModelPath == _modelPath && _loadedUseCuda == _useCuda) return true;
+
+	// Load the model (sessions are shared through the ModelRegistry, the previous model is released)
+	_executor.SetModel(nullptr);
+	delete _model;
 	_model = new YOLOv8(18, _confidenceThreshold);
-	_model->LoadModel(true, _modelPath);
+	bool loaded = _model->LoadModel(_useCuda, _modelPath);
+	if (!loaded && _useCuda)
+	{
+		// CPU only runtimes can't append the CUDA provider, the CPU also gets the profiles tuned for this machine
+		printf("CUDA unavailable, loading the model on the CPU\n");
+		delete _model;
+		_model = new YOLOv8(18, _confidenceThreshold);
+		loaded = _model->LoadModel(false, _modelPath);
+	}
+	if (!loaded)
+	{
+		delete _model;
+		_model = nullptr;
+		_loadedModelPath.clear();
+		return false;
+	}
+	_loadedModelPath = _modelPath;
+	_loadedUseCuda = _useCuda;
+	_inferenceSequence = 0;
 
 	// Run a warm-up inference
-	cv::Mat frame = WindowCaptureService::GetInstance().GetLatestFrame();
+	FrameHandle frameHandle = WindowCaptureService::GetInstance().GetLatestFrame();
+	cv::Mat frame = frameHandle->image;
 	_model->Inference(frame, _detectedItems);
+	_executor.SetModel(_model);
 
 	return true;
 }
@@ -55,47 +93,115 @@ void InventoryDropTask::Run(float deltaTime)
 		return;
 	}
 
-	// Update model params
-	_model->SetConfidenceThreshold(_confidenceThreshold);
-
-	// Run inference
-	_model->Inference(*tabFrame, _detectedItems);
+	// Skip inference when the tab didn't move nor change since the last inference
+	FrameRegion* tabRegion = nullptr;
+	bool shouldInfer = _confidenceThreshold != _inferenceConfidenceThreshold;
+	if (!resourceManager.TryGetResource(getTabRegionResource(TAB_INVENTORY), tabRegion) || tabRegion->frame == nullptr)
+	{
+		shouldInfer = true;
+	}
+	else if (tabRegion->rect != _inferenceRect || tabRegion->frame->HasChangedSince(tabRegion->rect, _inferenceSequence))
+	{
+		shouldInfer = true;
+	}
 
-	// Filter out the detections that overlap
-	size_t detectionCount = _detectedItems.size();
-	for (int i = 0; i < detectionCount; ++i)
+	// Pick up the latest async inference, it is tagged with the frame it ran on
+	bool hasNewDetections = false;
+	if (_executor.TakeLatestResult(_inferenceResult))
 	{
-		DetectionBox& curBox = _detectedItems[i];
-		for (int j = i + 1; j < _detectedItems.size(); j++)
+		// Detections are relative to the rect they ran on, a tab that moved since only shifts them
+		// (one that changed size has a different layout, its result is dropped until the request for it is done)
+		if (tabRegion == nullptr || _inferenceResult.rect.size() == tabRegion->rect.size())
 		{
-			DetectionBox& otherBox = _detectedItems[j];
-			if (curBox.IsSimilar(otherBox, 0.95))
+			const cv::Point offset = tabRegion != nullptr ? _inferenceResult.rect.tl() - tabRegion->rect.tl() : cv::Point();
+			for (auto& item : _inferenceResult.detections)
 			{
-				// Skip if class is different
-				if (curBox.classId != otherBox.classId) continue;
-
-				// Merge the two detections in current
-				curBox = curBox.Merge(otherBox);
+				item.x += offset.x;
+				item.y += offset.y;
+			}
+			_detectedItems.swap(_inferenceResult.detections);
+			hasNewDetections = true;
+		}
+	}
 
-				// Swap with last and pop
-				_detectedItems[j] = _detectedItems.back();
-				_detectedItems.pop_back();
+	if (shouldInfer)
+	{
+		// Update model params
+		_inferenceConfidenceThreshold = _confidenceThreshold;
+		_inferenceSequence = tabRegion != nullptr && tabRegion->frame != nullptr ? tabRegion->frame->sequence : 0;
+		_inferenceRect = tabRegion != nullptr ? tabRegion->rect : cv::Rect();
 
-				// Prevent j increment to check the new box
-				--j;
-			}
+		// Run inference, sharing the frame pyramid when we know where the tab came from
+		if (tabRegion != nullptr && tabRegion->frame != nullptr && _asyncInference)
+		{
+			_executor.SubmitLatest(tabRegion->frame, tabRegion->rect, _confidenceThreshold);
+		}
+		else if (tabRegion != nullptr && tabRegion->frame != nullptr)
+		{
+			_executor.RunNow(tabRegion->frame, tabRegion->rect, _confidenceThreshold, _detectedItems);
+			hasNewDetections = true;
+		}
+		else
+		{
+			// The executor might still be using the model
+			_executor.WaitIdle();
+			_model->SetConfidenceThreshold(_confidenceThreshold);
+			_model->Inference(*tabFrame, _detectedItems);
+			hasNewDetections = true;
 		}
 	}
 
+	if (hasNewDetections)
+	{
+		// Merge (or suppress) the detections that overlap
+		_postProcessor.Process(_detectedItems);
+	}
+
+	publish(*tabFrame);
+}
+
+bool InventoryDropTask::GetInputSignature(InputSignature& signature)
+{
+	// Detections still to come need a Run
+	if (_executor.HasPending() || _executor.HasLatestResult()) return false;
+
+	// Without the region there is nothing to diff the tab frame against
+	FrameRegion* tabRegion = nullptr;
+	if (!ResourceManager::GetInstance().TryGetResource(getTabRegionResource(TAB_INVENTORY), tabRegion) || tabRegion->frame == nullptr)
+	{
+		return false;
+	}
+
+	signature.AddRegion(*tabRegion->frame, tabRegion->rect);
+	signature.Add(_confidenceThreshold);
+	signature.Add((int)_postProcessor.GetConfig().mode);
+	signature.Add(_asyncInference);
+	return true;
+}
+
+void InventoryDropTask::Republish(float deltaTime)
+{
+	cv::Mat* tabFrame = nullptr;
+	if (ResourceManager::GetInstance().TryGetResource(TabNames[TAB_INVENTORY], tabFrame))
+	{
+		publish(*tabFrame);
+	}
+}
+
+void InventoryDropTask::publish(cv::Mat& tabFrame)
+{
 	// Draw the detected items
 	for (const auto& item : _detectedItems)
 	{
 		cv::Rect rect(item.x, item.y, item.w, item.h);
-		cv::rectangle(*tabFrame, rect, cv::Scalar(255, 255, 255), 2);
-		cv::putText(*tabFrame, fmt::format("{}", OreNames[item.classId]), rect.tl() - cv::Point{ 0, 5 }, cv::HersheyFonts::FONT_HERSHEY_PLAIN, 1.0, cv::Scalar(255, 255, 255), 2);
+		cv::rectangle(tabFrame, rect, cv::Scalar(255, 255, 255), 2);
+		cv::putText(tabFrame, fmt::format("{}", OreNames[item.classId]), rect.tl() - cv::Point{ 0, 5 }, cv::HersheyFonts::FONT_HERSHEY_PLAIN, 1.0, cv::Scalar(255, 255, 255), 2);
 	}
 
-	cv::imshow("Inventory Tab", *tabFrame);
+	if (_showTabWindow)
+	{
+		cv::imshow("Inventory Tab", tabFrame);
+	}
 }
 
 void InventoryDropTask::Draw()
@@ -113,9 +219,29 @@ void InventoryDropTask::Draw()
 	ImGui::SameLine();
 	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
 	ImGui::SliderFloat("##confidenceThreshold", &_confidenceThreshold, 0.05f, 1.0f);
+
+	ImGui::TextUnformatted("Post Processing:");
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+	int postProcessMode = _postProcessor.GetConfig().mode;
+	if (ImGui::Combo("##postProcessMode", &postProcessMode, PostProcessModeNames, IM_ARRAYSIZE(PostProcessModeNames)))
+	{
+		_postProcessor.SetMode((PostProcessMode)postProcessMode);
+	}
+
+	ImGui::Checkbox("Show Tab Window", &_showTabWindow);
+	ImGui::Checkbox("Use CUDA", &_useCuda);
+	ImGui::SetItemTooltip("Applied on the next start, falls back to the CPU when CUDA isn't available");
+	ImGui::Checkbox("Async Inference", &_asyncInference);
+	if (_asyncInference)
+	{
+		ImGui::SameLine();
+		ImGui::Text("%zu done, %zu dropped, %.1f ms", _executor.GetCompletedCount(), _executor.GetDroppedCount(), _executor.GetLastLatency());
+	}
 }
 
 void InventoryDropTask::GetInputResources(std::vector<std::string>& resources)
 {
 	resources.push_back(TabNames[TAB_INVENTORY]);
+	resources.push_back(getTabRegionResource(TAB_INVENTORY));
 }
\ No newline at end of file
@@ -162,8 +162,10 @@ void TrainingLabWindow::Run(float deltaTime)
 
 	if (ImGui::Begin("Training", nullptr, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse))
 	{
-		// Fetch a new copy of the image
-		_frame = _captureService.GetLatestFrame();
+		// Fetch the latest frame, only copying it when we have overlays to draw on top of it
+		_frameHandle = _captureService.GetLatestFrame();
+		const bool drawOverlays = _drawMouseMovements || _selMouseMovement != nullptr || _hovMouseMovement != nullptr;
+		_frame = drawOverlays ? _frameHandle->image.clone() : _frameHandle->image;
 
 		ImGui::SeparatorText("Welcome to the Training Lab!");
 		if (ImGui::BeginTable("##trainingTable", 2, ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_Resizable))
@@ -1,11 +1,16 @@
 
+#ifdef _WIN32
 // Windows dependencies
 #include <windows.h>
 #include <dwmapi.h> // For dark-mode support
 #pragma comment(lib, "dwmapi.lib")
+#endif
 
 // Std dependencies
+#include <filesystem>
 #include <iostream>
+#include <string>
+#include <tuple>
 #include <vector>
 
 // Third party dependencies
@@ -19,9 +24,16 @@
 #include <stb_image.h>
 
 // Internal dependencies
+#ifdef _WIN32
 #include <system/windowPicker.h>
+#include <system/frameSources/gdiFrameSource.h>
+#else
+#include <system/frameSources/x11FrameSource.h>
+#endif
 #include <system/inputManager.h>
 #include <system/windowCaptureService.h>
+#include <system/frameSources/replayFrameSource.h>
+#include <system/frameSources/mappedReplayFrameSource.h>
 
 #include <utils.h>
 
@@ -38,12 +50,33 @@ void glfwErrorCallback(int error, const char* description)
 
 void setDarkMode(GLFWwindow* window)
 {
+#ifdef _WIN32
 	HWND hwnd = glfwGetWin32Window(window);
 	if (!hwnd) return;
 
 	// Set dark mode
 	BOOL useDarkMode = true;
 	DwmSetWindowAttribute(hwnd, DWMWINDOWATTRIBUTE::DWMWA_USE_IMMERSIVE_DARK_MODE, &useDarkMode, sizeof(useDarkMode));
+#endif
+}
+
+// Recorded sessions and screenshots replace the live capture when given on the command line:
+//   --replay <session.osrsrec|image|image folder>  replays them in a loop
+//   --x11 <display>                                X11 display to capture off Windows (e.g. an Xvfb display, DISPLAY by default)
+IFrameSource* createReplaySource(int argc, char** argv, std::string& x11Display)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--replay" && i + 1 < argc)
+		{
+			const std::filesystem::path replayPath = argv[++i];
+			if (replayPath.extension() == ".osrsrec") return new MappedReplayFrameSource(replayPath, REPLAY_RECORDED_TIMING, true);
+			return new ReplayFrameSource(replayPath);
+		}
+		if (arg == "--x11" && i + 1 < argc) x11Display = argv[++i];
+	}
+	return nullptr;
 }
 
 int main(int argc, char** argv)
@@ -62,19 +95,39 @@ int main(int argc, char** argv)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-	std::cout << "Picking a monitor to track...\n";
-	std::flush(std::cout);
-    auto [hdc, trackingMonitor] = pickMonitorDialog();
-    if (!hdc)
+	// Pick the frame source, the live capture unless a replay was asked for
+	std::string x11Display;
+	IFrameSource* frameSource = createReplaySource(argc, argv, x11Display);
+	GLFWmonitor* trackingMonitor = nullptr;
+#ifdef _WIN32
+	HDC hdc = nullptr;
+	if (frameSource == nullptr)
+	{
+		std::cout << "Picking a monitor to track...\n";
+		std::flush(std::cout);
+		std::tie(hdc, trackingMonitor) = pickMonitorDialog();
+		if (!hdc)
+		{
+			std::cout << "ERROR! No monitor detected!\n";
+			return -1;
+		}
+		frameSource = new GdiFrameSource(hdc, glfwGetWin32Adapter(trackingMonitor));
+	}
+#else
+	if (frameSource == nullptr) frameSource = new X11FrameSource(x11Display);
+#endif
+	if (frameSource->GetCaptureRect().empty())
 	{
-		std::cout << "ERROR! No monitor detected!\n";
+		std::cout << "ERROR! '" << frameSource->GetName() << "' frame source has nothing to capture!\n";
+		delete frameSource;
 		return -1;
 	}
 
-	std::cout << "Starting capture service...\n";
+	std::cout << "Starting capture service (" << frameSource->GetName() << ")...\n";
 	std::flush(std::cout);
 	WindowCaptureService& captureService = WindowCaptureService::GetInstance();
-	captureService.StartCapture(hdc, glfwGetWin32Adapter(trackingMonitor));
+	captureService.SetCaptureRate(60);
+	captureService.StartCapture(frameSource);
 
     // Create a windowed mode window and its OpenGL context
 	glfwWindowHint(GLFW_DECORATED, GLFW_TRUE);
@@ -224,7 +277,9 @@ int main(int argc, char** argv)
 	// (IMPORTANT) Stop capturing before deleting window handle
 	captureService.StopCapture();
 
-	DeleteDC(hdc);
+#ifdef _WIN32
+	if (hdc) DeleteDC(hdc);
+#endif
 
     glfwDestroyWindow(window);
     glfwTerminate();
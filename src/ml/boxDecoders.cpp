@@ -0,0 +1,314 @@
+#include <ml/boxDecoders.h>
+
+// Std dependencies
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Third party dependencies
+#include <opencv2/core/hal/intrin.hpp>
+
+// Maps the box of a prediction (center and size) back to the source image
+template<BoxEncoding TEncoding>
+static inline void emitYOLOv8Box(float cx, float cy, float w, float h, int classId, float confidence, const cv::Size& inputSize,
+								 const cv::Vec2f& inputScale, const cv::Vec2f& inputPadding, std::vector<DetectionBox>& detections)
+{
+	if constexpr (TEncoding == BOX_CXCYWH_NORMALIZED)
+	{
+		cx *= inputSize.width;
+		cy *= inputSize.height;
+		w *= inputSize.width;
+		h *= inputSize.height;
+	}
+
+	DetectionBox box;
+	box.x = (cx - w * 0.5f - inputPadding[0]) / inputScale[0];
+	box.y = (cy - h * 0.5f - inputPadding[1]) / inputScale[1];
+	box.w = w / inputScale[0];
+	box.h = h / inputScale[1];
+	box.classId = classId;
+	box.confidence = confidence;
+	detections.push_back(box);
+}
+
+// Channel major: a running argmax over the score planes, one prediction per SIMD lane,
+// only predictions whose best score beats the threshold have their geometry read
+template<int TClassCount, BoxEncoding TEncoding>
+static void decodeChannelMajor(const float* output, int predictionCount, int runtimeClassCount, float confidenceThreshold, const cv::Size& inputSize,
+							   const cv::Vec2f& inputScale, const cv::Vec2f& inputPadding, std::vector<DetectionBox>& detections)
+{
+	// Constant for the specializations
+	const int classCount = TClassCount > 0 ? TClassCount : runtimeClassCount;
+	const float* scores = output + 4 * (size_t)predictionCount;
+	auto emit = [&](int prediction, int classId, float confidence)
+	{
+		emitYOLOv8Box<TEncoding>(output[prediction], output[predictionCount + prediction], output[2 * predictionCount + prediction],
+								 output[3 * predictionCount + prediction], classId, confidence, inputSize, inputScale, inputPadding, detections);
+	};
+
+	int prediction = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+	{
+		using namespace cv;
+		const int lanes = VTraits<v_float32>::vlanes();
+		const v_float32 threshold = vx_setall_f32(confidenceThreshold);
+
+		// Spilled only when some lane passes the threshold
+		float bestScores[VTraits<v_float32>::max_nlanes];
+		int bestClasses[VTraits<v_int32>::max_nlanes];
+
+		for (; prediction <= predictionCount - lanes; prediction += lanes)
+		{
+			// Strictly greater keeps the first class on ties (same as minMaxLoc)
+			v_float32 best = vx_load(scores + prediction);
+			v_int32 bestClass = vx_setzero_s32();
+			for (int c = 1; c < classCount; ++c)
+			{
+				const v_float32 score = vx_load(scores + (size_t)c * predictionCount + prediction);
+				const v_float32 greater = v_gt(score, best);
+				best = v_select(greater, score, best);
+				bestClass = v_select(v_reinterpret_as_s32(greater), vx_setall_s32(c), bestClass);
+			}
+
+			// Most blocks don't have a single candidate
+			if (!v_check_any(v_gt(best, threshold))) continue;
+
+			v_store(bestScores, best);
+			v_store(bestClasses, bestClass);
+			for (int lane = 0; lane < lanes; ++lane)
+			{
+				if (bestScores[lane] > confidenceThreshold) emit(prediction + lane, bestClasses[lane], bestScores[lane]);
+			}
+		}
+	}
+#endif
+
+	// Remaining predictions
+	for (; prediction < predictionCount; ++prediction)
+	{
+		float best = scores[prediction];
+		int bestClass = 0;
+		for (int c = 1; c < classCount; ++c)
+		{
+			const float score = scores[(size_t)c * predictionCount + prediction];
+			if (score > best)
+			{
+				best = score;
+				bestClass = c;
+			}
+		}
+		if (best > confidenceThreshold) emit(prediction, bestClass, best);
+	}
+}
+
+// Prediction major: the scores of a prediction are contiguous, their maximum is reduced first
+// (branchless, so it vectorizes) and the argmax is only looked up for predictions beating the threshold
+template<int TClassCount, BoxEncoding TEncoding>
+static void decodePredictionMajor(const float* output, int predictionCount, int featureCount, int runtimeClassCount, float confidenceThreshold,
+								  const cv::Size& inputSize, const cv::Vec2f& inputScale, const cv::Vec2f& inputPadding,
+								  std::vector<DetectionBox>& detections)
+{
+	const int classCount = TClassCount > 0 ? TClassCount : runtimeClassCount;
+	for (int prediction = 0; prediction < predictionCount; ++prediction)
+	{
+		const float* row = output + (size_t)prediction * featureCount;
+		const float* scores = row + 4;
+
+		float best = scores[0];
+		for (int c = 1; c < classCount; ++c)
+		{
+			best = std::max(best, scores[c]);
+		}
+		if (!(best > confidenceThreshold)) continue;
+
+		// First class reaching the maximum, same as minMaxLoc
+		int bestClass = 0;
+		while (scores[bestClass] != best) ++bestClass;
+		emitYOLOv8Box<TEncoding>(row[0], row[1], row[2], row[3], bestClass, best, inputSize, inputScale, inputPadding, detections);
+	}
+}
+
+template<int TClassCount, BoxEncoding TEncoding, OutputLayout TLayout>
+static void decodeYOLOv8Head(const float* output, int predictionCount, int featureCount, int classCount, float confidenceThreshold,
+							 const cv::Size& inputSize, const cv::Vec2f& inputScale, const cv::Vec2f& inputPadding, std::vector<DetectionBox>& detections)
+{
+	detections.clear();
+	if (output == nullptr || predictionCount <= 0 || classCount <= 0) return;
+
+	if constexpr (TLayout == LAYOUT_CHANNEL_MAJOR)
+	{
+		decodeChannelMajor<TClassCount, TEncoding>(output, predictionCount, classCount, confidenceThreshold, inputSize, inputScale, inputPadding,
+												   detections);
+	}
+	else
+	{
+		decodePredictionMajor<TClassCount, TEncoding>(output, predictionCount, featureCount, classCount, confidenceThreshold, inputSize, inputScale,
+													  inputPadding, detections);
+	}
+}
+
+// Every encoding and layout for a class count (0 being the generic decoder), indexed [encoding][layout]
+template<int TClassCount>
+static YOLOv8DecodeFunction selectYOLOv8Head(BoxEncoding encoding, OutputLayout layout)
+{
+	static const YOLOv8DecodeFunction decoders[2][2] = {
+		{ decodeYOLOv8Head<TClassCount, BOX_CXCYWH_PIXELS, LAYOUT_CHANNEL_MAJOR>, decodeYOLOv8Head<TClassCount, BOX_CXCYWH_PIXELS, LAYOUT_PREDICTION_MAJOR> },
+		{ decodeYOLOv8Head<TClassCount, BOX_CXCYWH_NORMALIZED, LAYOUT_CHANNEL_MAJOR>,
+		  decodeYOLOv8Head<TClassCount, BOX_CXCYWH_NORMALIZED, LAYOUT_PREDICTION_MAJOR> }
+	};
+	return decoders[encoding][layout];
+}
+
+YOLOv8DecodeFunction selectYOLOv8Decoder(int classCount, BoxEncoding encoding, OutputLayout layout, bool* specialized)
+{
+	// Class counts of the models we ship
+	YOLOv8DecodeFunction decoder;
+	switch (classCount)
+	{
+	case 8: decoder = selectYOLOv8Head<8>(encoding, layout); break;
+	case 18: decoder = selectYOLOv8Head<18>(encoding, layout); break;
+	default: decoder = selectYOLOv8Head<0>(encoding, layout); break;
+	}
+	if (specialized != nullptr) *specialized = classCount == 8 || classCount == 18;
+	return decoder;
+}
+
+void decodeYOLOv8(const float* output, int predictionCount, int classCount, float confidenceThreshold, const cv::Vec2f& inputScale,
+				  const cv::Vec2f& inputPadding, std::vector<DetectionBox>& detections)
+{
+	// Generic channel major decoder in input pixels (the input size is only used by normalized encodings)
+	decodeYOLOv8Head<0, BOX_CXCYWH_PIXELS, LAYOUT_CHANNEL_MAJOR>(output, predictionCount, classCount + 4, classCount, confidenceThreshold, cv::Size(),
+																  inputScale, inputPadding, detections);
+}
+
+void decodeYOLOv8Reference(const float* output, int predictionCount, int classCount, float confidenceThreshold, const cv::Vec2f& inputScale,
+						   const cv::Vec2f& inputPadding, cv::Mat& transposedOutput, std::vector<DetectionBox>& detections)
+{
+	detections.clear();
+	if (output == nullptr || predictionCount <= 0 || classCount <= 0) return;
+
+	// Transpose: [features, preds_num] => [preds_num, features]
+	const int geomStride = 4; // number of geometry parameters {x, y, w, h}
+	const int dataWidth = classCount + geomStride;
+	cv::transpose(cv::Mat(cv::Size(predictionCount, dataWidth), CV_32F, const_cast<float*>(output)), transposedOutput);
+
+	const float* pData = (const float*)transposedOutput.data;
+	for (int r = 0; r < transposedOutput.rows; ++r)
+	{
+		cv::Mat scores(1, classCount, CV_32FC1, const_cast<float*>(pData + geomStride));
+		cv::Point classId;
+		double maxConf;
+		cv::minMaxLoc(scores, nullptr, &maxConf, nullptr, &classId);
+
+		if (maxConf > confidenceThreshold)
+		{
+			DetectionBox box;
+			box.x = (pData[0] - pData[2] * 0.5f - inputPadding[0]) / inputScale[0];
+			box.y = (pData[1] - pData[3] * 0.5f - inputPadding[1]) / inputScale[1];
+			box.w = pData[2] / inputScale[0];
+			box.h = pData[3] / inputScale[1];
+			box.classId = classId.x;
+			box.confidence = (float)maxConf;
+			detections.push_back(box);
+		}
+		pData += dataWidth; // next pred
+	}
+}
+
+// Maps a relative center/size box of the input back to the source image
+static inline void emitRFDETRBox(const float* box, int classId, float confidence, const cv::Size& inputSize, const cv::Vec2f& inputScale,
+								 const cv::Vec2f& inputPadding, std::vector<DetectionBox>& detections)
+{
+	// Clamp width and height to minimum 0
+	const float w = std::max(0.0f, box[2]);
+	const float h = std::max(0.0f, box[3]);
+
+	// Center-width-height to x1y1x2y2, then from relative [0,1] to source pixels
+	const float x1 = ((box[0] - 0.5f * w) * inputSize.width - inputPadding[0]) / inputScale[0];
+	const float y1 = ((box[1] - 0.5f * h) * inputSize.height - inputPadding[1]) / inputScale[1];
+	const float x2 = ((box[0] + 0.5f * w) * inputSize.width - inputPadding[0]) / inputScale[0];
+	const float y2 = ((box[1] + 0.5f * h) * inputSize.height - inputPadding[1]) / inputScale[1];
+
+	DetectionBox detection;
+	detection.x = x1;
+	detection.y = y1;
+	detection.w = x2 - x1;
+	detection.h = y2 - y1;
+	detection.classId = classId;
+	detection.confidence = confidence;
+	detections.push_back(detection);
+}
+
+void decodeRFDETR(const float* boxes, const float* logits, int queryCount, int classCount, float confidenceThreshold, int maxDetections,
+				  const cv::Size& inputSize, const cv::Vec2f& inputScale, const cv::Vec2f& inputPadding,
+				  std::vector<std::pair<float, int>>& candidates, std::vector<DetectionBox>& detections)
+{
+	detections.clear();
+	candidates.clear();
+	if (boxes == nullptr || logits == nullptr || queryCount <= 0 || classCount <= 0 || maxDetections <= 0) return;
+
+	// sigmoid(logit) >= threshold <=> logit >= log(threshold / (1 - threshold))
+	float logitThreshold;
+	if (confidenceThreshold <= 0.0f) logitThreshold = -std::numeric_limits<float>::infinity();
+	else if (confidenceThreshold >= 1.0f) logitThreshold = std::numeric_limits<float>::infinity();
+	else logitThreshold = std::log(confidenceThreshold / (1.0f - confidenceThreshold));
+
+	// Most logits are far below the threshold, only the survivors are kept
+	const int logitCount = queryCount * classCount;
+	for (int i = 0; i < logitCount; ++i)
+	{
+		if (logits[i] >= logitThreshold) candidates.emplace_back(logits[i], i);
+	}
+
+	// Best first (the sigmoid is monotonic, so logits order the same as probabilities)
+	auto higher = [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; };
+	if (candidates.size() > (size_t)maxDetections)
+	{
+		std::nth_element(candidates.begin(), candidates.begin() + maxDetections, candidates.end(), higher);
+		candidates.resize(maxDetections);
+	}
+	std::sort(candidates.begin(), candidates.end(), higher);
+
+	for (const auto& candidate : candidates)
+	{
+		const float score = 1.0f / (1.0f + std::exp(-candidate.first));
+		const int query = candidate.second / classCount;
+		emitRFDETRBox(boxes + (size_t)query * 4, candidate.second % classCount, score, inputSize, inputScale, inputPadding, detections);
+	}
+}
+
+void decodeRFDETRReference(const float* boxes, const float* logits, int queryCount, int classCount, float confidenceThreshold, int maxDetections,
+						   const cv::Size& inputSize, const cv::Vec2f& inputScale, const cv::Vec2f& inputPadding,
+						   std::vector<DetectionBox>& detections)
+{
+	detections.clear();
+	if (boxes == nullptr || logits == nullptr || queryCount <= 0 || classCount <= 0 || maxDetections <= 0) return;
+
+	// Apply sigmoid to logits to get probabilities
+	std::vector<float> probs(queryCount * classCount);
+	for (int i = 0; i < queryCount * classCount; ++i)
+	{
+		probs[i] = 1.0f / (1.0f + std::exp(-logits[i]));
+	}
+
+	// Select top detections
+	const int num_select = std::min(maxDetections, queryCount * classCount);
+	std::vector<std::pair<float, int>> prob_index_pairs;
+	for (int i = 0; i < queryCount * classCount; ++i)
+	{
+		prob_index_pairs.emplace_back(probs[i], i);
+	}
+
+	// Sort by probability (descending)
+	std::partial_sort(prob_index_pairs.begin(), prob_index_pairs.begin() + num_select, prob_index_pairs.end(),
+					  [](const auto& a, const auto& b) { return a.first > b.first; });
+
+	for (int i = 0; i < num_select; ++i)
+	{
+		const float score = prob_index_pairs[i].first;
+		if (score < confidenceThreshold) continue;
+
+		const int query = prob_index_pairs[i].second / classCount;
+		emitRFDETRBox(boxes + (size_t)query * 4, prob_index_pairs[i].second % classCount, score, inputSize, inputScale, inputPadding, detections);
+	}
+}
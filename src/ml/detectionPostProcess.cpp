@@ -0,0 +1,234 @@
+#include <ml/detectionPostProcess.h>
+
+// Std dependencies
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Third party dependencies
+#include <opencv2/core/hal/intrin.hpp>
+
+void DetectionPostProcessor::Process(std::vector<DetectionBox>& detections)
+{
+	if (_config.mode == POSTPROCESS_NONE || detections.size() < 2) return;
+
+	load(detections);
+
+	// Each class is a contiguous run, only boxes within it are compared
+	const int count = (int)_scores.size();
+	for (int begin = 0; begin < count;)
+	{
+		int end = begin + 1;
+		while (end < count && (!_config.classAware || _classIds[end] == _classIds[begin])) ++end;
+
+		switch (_config.mode)
+		{
+		case POSTPROCESS_NMS: nms(begin, end); break;
+		case POSTPROCESS_SOFT_NMS: softNms(begin, end); break;
+		case POSTPROCESS_MERGE: merge(begin, end); break;
+		default: break;
+		}
+		begin = end;
+	}
+
+	detections.clear();
+	for (int i = 0; i < count; ++i)
+	{
+		if (!_kept[i]) continue;
+
+		DetectionBox box;
+		box.x = _x1[i];
+		box.y = _y1[i];
+		box.w = _x2[i] - _x1[i];
+		box.h = _y2[i] - _y1[i];
+		box.classId = _classIds[i];
+		box.confidence = _scores[i];
+		detections.push_back(box);
+	}
+}
+
+void DetectionPostProcessor::load(const std::vector<DetectionBox>& detections)
+{
+	const int count = (int)detections.size();
+
+	// Sort by class (when class aware), then best score first
+	_order.resize(count);
+	std::iota(_order.begin(), _order.end(), 0);
+	const bool classAware = _config.classAware;
+	std::sort(_order.begin(), _order.end(), [&](int a, int b)
+	{
+		if (classAware && detections[a].classId != detections[b].classId) return detections[a].classId < detections[b].classId;
+		return detections[a].confidence > detections[b].confidence;
+	});
+
+	_x1.resize(count);
+	_y1.resize(count);
+	_x2.resize(count);
+	_y2.resize(count);
+	_areas.resize(count);
+	_scores.resize(count);
+	_classIds.resize(count);
+	_kept.assign(count, 1);
+	_overlaps.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		const DetectionBox& box = detections[_order[i]];
+		_x1[i] = box.x;
+		_y1[i] = box.y;
+		_x2[i] = box.x + box.w;
+		_y2[i] = box.y + box.h;
+		_areas[i] = box.w * box.h;
+		_scores[i] = box.confidence;
+		_classIds[i] = box.classId;
+	}
+}
+
+void DetectionPostProcessor::swapBoxes(int a, int b)
+{
+	std::swap(_x1[a], _x1[b]);
+	std::swap(_y1[a], _y1[b]);
+	std::swap(_x2[a], _x2[b]);
+	std::swap(_y2[a], _y2[b]);
+	std::swap(_areas[a], _areas[b]);
+	std::swap(_scores[a], _scores[b]);
+	std::swap(_classIds[a], _classIds[b]);
+	std::swap(_kept[a], _kept[b]);
+}
+
+void DetectionPostProcessor::computeOverlaps(int i, int begin, int end, bool overSmallest)
+{
+	const float x1 = _x1[i], y1 = _y1[i], x2 = _x2[i], y2 = _y2[i], area = _areas[i];
+	const float epsilon = 1e-9f;
+	float* overlaps = _overlaps.data();
+
+	int j = begin;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+	{
+		using namespace cv;
+		const int lanes = VTraits<v_float32>::vlanes();
+		const v_float32 vX1 = vx_setall_f32(x1), vY1 = vx_setall_f32(y1), vX2 = vx_setall_f32(x2), vY2 = vx_setall_f32(y2);
+		const v_float32 vArea = vx_setall_f32(area), zero = vx_setzero_f32(), vEpsilon = vx_setall_f32(epsilon);
+		for (; j <= end - lanes; j += lanes)
+		{
+			const v_float32 width = v_max(v_sub(v_min(vX2, vx_load(&_x2[j])), v_max(vX1, vx_load(&_x1[j]))), zero);
+			const v_float32 height = v_max(v_sub(v_min(vY2, vx_load(&_y2[j])), v_max(vY1, vx_load(&_y1[j]))), zero);
+			const v_float32 intersection = v_mul(width, height);
+			const v_float32 areas = vx_load(&_areas[j]);
+			const v_float32 denominator = overSmallest ? v_min(vArea, areas) : v_sub(v_add(vArea, areas), intersection);
+			v_store(overlaps + (j - begin), v_div(intersection, v_max(denominator, vEpsilon)));
+		}
+	}
+#endif
+
+	for (; j < end; ++j)
+	{
+		const float width = std::max(std::min(x2, _x2[j]) - std::max(x1, _x1[j]), 0.0f);
+		const float height = std::max(std::min(y2, _y2[j]) - std::max(y1, _y1[j]), 0.0f);
+		const float intersection = width * height;
+		const float denominator = overSmallest ? std::min(area, _areas[j]) : area + _areas[j] - intersection;
+		overlaps[j - begin] = intersection / std::max(denominator, epsilon);
+	}
+}
+
+void DetectionPostProcessor::nms(int begin, int end)
+{
+	// Boxes are sorted best first, each kept box suppresses the worse ones overlapping it
+	for (int i = begin; i < end; ++i)
+	{
+		if (!_kept[i]) continue;
+
+		computeOverlaps(i, i + 1, end, false);
+		for (int j = i + 1; j < end; ++j)
+		{
+			if (_overlaps[j - i - 1] > _config.overlapThreshold) _kept[j] = 0;
+		}
+	}
+}
+
+void DetectionPostProcessor::softNms(int begin, int end)
+{
+	// Scores change as boxes get decayed, so the best remaining one is looked up on every step
+	const float sigma = std::max(_config.softNmsSigma, 1e-6f);
+	for (int i = begin; i < end; ++i)
+	{
+		int best = i;
+		for (int j = i + 1; j < end; ++j)
+		{
+			if (_scores[j] > _scores[best]) best = j;
+		}
+		swapBoxes(i, best);
+		if (_scores[i] < _config.softNmsMinScore)
+		{
+			// Everything left scores even lower
+			std::fill(_kept.begin() + i, _kept.begin() + end, 0);
+			return;
+		}
+
+		computeOverlaps(i, i + 1, end, false);
+		for (int j = i + 1; j < end; ++j)
+		{
+			const float overlap = _overlaps[j - i - 1];
+			if (overlap > 0.0f) _scores[j] *= std::exp(-(overlap * overlap) / sigma);
+		}
+	}
+}
+
+void DetectionPostProcessor::merge(int begin, int end)
+{
+	// Each kept box absorbs the worse ones overlapping it, growing as it goes
+	for (int i = begin; i < end; ++i)
+	{
+		if (!_kept[i]) continue;
+
+		int next = i + 1;
+		while (next < end)
+		{
+			computeOverlaps(i, next, end, true);
+
+			int j = next;
+			for (; j < end; ++j)
+			{
+				if (_kept[j] && _overlaps[j - next] > _config.overlapThreshold) break;
+			}
+			if (j == end) break;
+
+			// The box grew, the overlaps of the remaining boxes are recomputed
+			_x1[i] = std::min(_x1[i], _x1[j]);
+			_y1[i] = std::min(_y1[i], _y1[j]);
+			_x2[i] = std::max(_x2[i], _x2[j]);
+			_y2[i] = std::max(_y2[i], _y2[j]);
+			_areas[i] = (_x2[i] - _x1[i]) * (_y2[i] - _y1[i]);
+			_kept[j] = 0;
+			next = j + 1;
+		}
+	}
+}
+
+void mergeOverlappingReference(std::vector<DetectionBox>& detections)
+{
+	// Filter out the detections that overlap (bounded by the current size, the tasks kept the initial
+	// one and could read past the end once boxes were popped)
+	for (int i = 0; i < detections.size(); ++i)
+	{
+		DetectionBox& curBox = detections[i];
+		for (int j = i + 1; j < detections.size(); j++)
+		{
+			DetectionBox& otherBox = detections[j];
+			if (curBox.IsSimilar(otherBox, 0.95f))
+			{
+				// Skip if class is different
+				if (curBox.classId != otherBox.classId) continue;
+
+				// Merge the two detections in current
+				curBox = curBox.Merge(otherBox);
+
+				// Swap with last and pop
+				detections[j] = detections.back();
+				detections.pop_back();
+
+				// Prevent j increment to check the new box
+				--j;
+			}
+		}
+	}
+}
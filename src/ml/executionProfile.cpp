@@ -0,0 +1,274 @@
+#include <ml/executionProfile.h>
+
+// Std dependencies
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// Third party dependencies
+#include <nlohmann/json.hpp>
+
+// Internal dependencies
+#include <ml/onnxruntimeInference.h>
+
+std::string ExecutionProfile::GetKey() const
+{
+	const std::string flags = std::to_string(memoryPattern) + std::to_string(cpuArena) + std::to_string(parallelExecution);
+	if (useGlobalThreadPools) return "global|" + flags;
+
+	return "own|" + std::to_string(intraOpThreads) + "|" + std::to_string(interOpThreads) + "|" + std::to_string(allowSpinning) + flags + "|" +
+		   GetAffinityString();
+}
+
+std::string ExecutionProfile::GetAffinityString() const
+{
+	if (useGlobalThreadPools || affinity == AFFINITY_NONE) return "";
+	if (affinity == AFFINITY_CUSTOM) return customAffinity;
+
+	// One entry per thread besides the caller, which ORT doesn't pin
+	const int processorCount = (int)std::thread::hardware_concurrency();
+	const int step = affinity == AFFINITY_SPREAD ? 2 : 1;
+	if (intraOpThreads <= 1 || step * (intraOpThreads - 1) + 1 > processorCount) return "";
+
+	std::string affinities;
+	for (int thread = 1; thread < intraOpThreads; ++thread)
+	{
+		if (!affinities.empty()) affinities += ";";
+		affinities += std::to_string(thread * step + 1);
+	}
+	return affinities;
+}
+
+std::string ExecutionProfile::ToString() const
+{
+	std::string text = useGlobalThreadPools ? "global pools" : "intra " + std::to_string(intraOpThreads) + ", inter " + std::to_string(interOpThreads);
+	if (!useGlobalThreadPools)
+	{
+		text += std::string(", ") + ThreadAffinityNames[affinity] + " affinity";
+		text += allowSpinning ? ", spinning" : ", blocking";
+	}
+	text += parallelExecution ? ", parallel" : ", sequential";
+	if (!memoryPattern) text += ", no memory pattern";
+	if (!cpuArena) text += ", no arena";
+	return text;
+}
+
+bool ExecutionProfileStore::Load(const std::filesystem::path& path)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_loaded = true;
+
+	std::ifstream file(path);
+	if (!file.is_open()) return false;
+
+	nlohmann::json j;
+	try
+	{
+		file >> j;
+		for (const auto& [key, jProfile] : j.items())
+		{
+			ExecutionProfile profile;
+			profile.useGlobalThreadPools = jProfile.value("useGlobalThreadPools", profile.useGlobalThreadPools);
+			profile.intraOpThreads = jProfile.value("intraOpThreads", profile.intraOpThreads);
+			profile.interOpThreads = jProfile.value("interOpThreads", profile.interOpThreads);
+			profile.affinity = (ThreadAffinity)std::clamp(jProfile.value("affinity", (int)profile.affinity), 0, (int)AFFINITY_CUSTOM);
+			profile.customAffinity = jProfile.value("customAffinity", profile.customAffinity);
+			profile.allowSpinning = jProfile.value("allowSpinning", profile.allowSpinning);
+			profile.memoryPattern = jProfile.value("memoryPattern", profile.memoryPattern);
+			profile.cpuArena = jProfile.value("cpuArena", profile.cpuArena);
+			profile.parallelExecution = jProfile.value("parallelExecution", profile.parallelExecution);
+			profile.tunedLatency = jProfile.value("tunedLatency", profile.tunedLatency);
+			_profiles[key] = profile;
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		std::cout << "Execution profiles load error! Msg: " << ex.what() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool ExecutionProfileStore::Save(const std::filesystem::path& path)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	nlohmann::json j = nlohmann::json::object();
+	for (const auto& [key, profile] : _profiles)
+	{
+		nlohmann::json jProfile;
+		jProfile["useGlobalThreadPools"] = profile.useGlobalThreadPools;
+		jProfile["intraOpThreads"] = profile.intraOpThreads;
+		jProfile["interOpThreads"] = profile.interOpThreads;
+		jProfile["affinity"] = (int)profile.affinity;
+		jProfile["customAffinity"] = profile.customAffinity;
+		jProfile["allowSpinning"] = profile.allowSpinning;
+		jProfile["memoryPattern"] = profile.memoryPattern;
+		jProfile["cpuArena"] = profile.cpuArena;
+		jProfile["parallelExecution"] = profile.parallelExecution;
+		jProfile["tunedLatency"] = profile.tunedLatency;
+		j[key] = jProfile;
+	}
+
+	std::ofstream file(path);
+	if (!file.is_open()) return false;
+	file << j.dump(4);
+	return true;
+}
+
+bool ExecutionProfileStore::Find(const std::filesystem::path& modelPath, bool useCuda, ExecutionProfile& profile)
+{
+	if (!_loaded) Load();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _profiles.find(getKey(modelPath, useCuda));
+	if (it == _profiles.end()) return false;
+	profile = it->second;
+	return true;
+}
+
+void ExecutionProfileStore::Set(const std::filesystem::path& modelPath, bool useCuda, const ExecutionProfile& profile)
+{
+	// Keeps the profiles of other models and machines
+	if (!_loaded) Load();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_profiles[getKey(modelPath, useCuda)] = profile;
+}
+
+std::string ExecutionProfileStore::GetMachineKey()
+{
+	std::string hostName;
+#ifdef _WIN32
+	if (const char* computerName = std::getenv("COMPUTERNAME")) hostName = computerName;
+#else
+	char name[256] = {};
+	if (gethostname(name, sizeof(name) - 1) == 0) hostName = name;
+#endif
+	return hostName + "|" + std::to_string(std::thread::hardware_concurrency());
+}
+
+std::string ExecutionProfileStore::getKey(const std::filesystem::path& modelPath, bool useCuda) const
+{
+	return GetMachineKey() + "|" + modelPath.filename().string() + (useCuda ? "|cuda" : "|cpu");
+}
+
+double ExecutionTuner::measure(const std::filesystem::path& modelPath, const std::vector<cv::Mat>& frames, const ExecutionProfile& profile)
+{
+	PreProcessBoxDetectionBase* model = _createModel();
+	model->SetExecutionProfile(profile);
+	if (!model->LoadModel(false, modelPath.wstring().c_str()))
+	{
+		delete model;
+		return -1.0;
+	}
+
+	// A pass over the frames first, so the arena and memory pattern are settled
+	std::vector<DetectionBox> boxes;
+	for (const cv::Mat& frame : frames)
+	{
+		cv::Mat image = frame;
+		model->Inference(image, boxes);
+	}
+
+	std::vector<double> latencies;
+	latencies.reserve(_iterations);
+	for (int i = 0; i < _iterations; ++i)
+	{
+		cv::Mat image = frames[i % frames.size()];
+		const auto start = std::chrono::steady_clock::now();
+		model->Inference(image, boxes);
+		latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+	delete model;
+
+	std::nth_element(latencies.begin(), latencies.begin() + latencies.size() / 2, latencies.end());
+	return latencies[latencies.size() / 2];
+}
+
+void ExecutionTuner::tryProfile(const std::filesystem::path& modelPath, const std::vector<cv::Mat>& frames, const ExecutionProfile& profile,
+								ExecutionProfile& bestProfile)
+{
+	// Already measured (the sweeps overlap on the current best)
+	for (const ExecutionProfile& measured : _measured)
+	{
+		if (measured.GetKey() == profile.GetKey()) return;
+	}
+
+	ExecutionProfile candidate = profile;
+	candidate.tunedLatency = measure(modelPath, frames, profile);
+	if (candidate.tunedLatency < 0.0) return;
+
+	printf("Tuning %s: %8.3f ms  %s\n", modelPath.filename().string().c_str(), candidate.tunedLatency, candidate.ToString().c_str());
+	_measured.push_back(candidate);
+	if (bestProfile.tunedLatency <= 0.0 || candidate.tunedLatency < bestProfile.tunedLatency) bestProfile = candidate;
+}
+
+bool ExecutionTuner::Tune(const std::filesystem::path& modelPath, const std::vector<cv::Mat>& frames, ExecutionProfile& bestProfile)
+{
+	_measured.clear();
+	bestProfile = ExecutionProfile();
+	if (frames.empty()) return false;
+
+	// Baseline, the shared single threaded pools
+	tryProfile(modelPath, frames, bestProfile, bestProfile);
+	if (_measured.empty()) return false;
+
+	// Thread count, on pools of its own
+	const int processorCount = std::max(1, (int)std::thread::hardware_concurrency());
+	std::vector<int> threadCounts = { 1, 2, 4, processorCount / 2, processorCount, 0 };
+	threadCounts.erase(std::remove_if(threadCounts.begin(), threadCounts.end(), [&](int count) { return count < 0 || count > processorCount; }),
+					   threadCounts.end());
+	const ExecutionProfile threadBase = bestProfile;
+	for (int threadCount : threadCounts)
+	{
+		ExecutionProfile profile = threadBase;
+		profile.useGlobalThreadPools = false;
+		profile.intraOpThreads = threadCount;
+		tryProfile(modelPath, frames, profile, bestProfile);
+	}
+
+	// Placement and wait policy only matter once the session has its own threads
+	if (!bestProfile.useGlobalThreadPools)
+	{
+		const ExecutionProfile affinityBase = bestProfile;
+		for (ThreadAffinity affinity : { AFFINITY_COMPACT, AFFINITY_SPREAD })
+		{
+			ExecutionProfile profile = affinityBase;
+			profile.affinity = affinity;
+			if (!profile.GetAffinityString().empty()) tryProfile(modelPath, frames, profile, bestProfile);
+		}
+
+		ExecutionProfile profile = bestProfile;
+		profile.allowSpinning = !profile.allowSpinning;
+		tryProfile(modelPath, frames, profile, bestProfile);
+
+		// Parallel branches need inter op threads
+		const ExecutionProfile parallelBase = bestProfile;
+		for (int interOpThreads : { 2, 4 })
+		{
+			if (interOpThreads > processorCount) continue;
+			profile = parallelBase;
+			profile.parallelExecution = true;
+			profile.interOpThreads = interOpThreads;
+			tryProfile(modelPath, frames, profile, bestProfile);
+		}
+	}
+
+	// Memory settings last, their effect is the smallest
+	ExecutionProfile profile = bestProfile;
+	profile.memoryPattern = !profile.memoryPattern;
+	tryProfile(modelPath, frames, profile, bestProfile);
+	profile = bestProfile;
+	profile.cpuArena = !profile.cpuArena;
+	tryProfile(modelPath, frames, profile, bestProfile);
+	return true;
+}
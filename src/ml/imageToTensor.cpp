@@ -0,0 +1,208 @@
+#include <ml/imageToTensor.h>
+
+// Std dependencies
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Third party dependencies
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/dnn/dnn.hpp>
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+// Widens 8-bit lanes to float and stores pixel * scale + offset
+static inline void storeScaled(const cv::v_uint8& pixels, float* dst, const cv::v_float32& scale, const cv::v_float32& offset)
+{
+	using namespace cv;
+	const int floatLanes = VTraits<v_float32>::vlanes();
+
+	v_uint16 low, high;
+	v_expand(pixels, low, high);
+	v_uint32 q0, q1, q2, q3;
+	v_expand(low, q0, q1);
+	v_expand(high, q2, q3);
+
+	v_store(dst, v_fma(v_cvt_f32(v_reinterpret_as_s32(q0)), scale, offset));
+	v_store(dst + floatLanes, v_fma(v_cvt_f32(v_reinterpret_as_s32(q1)), scale, offset));
+	v_store(dst + floatLanes * 2, v_fma(v_cvt_f32(v_reinterpret_as_s32(q2)), scale, offset));
+	v_store(dst + floatLanes * 3, v_fma(v_cvt_f32(v_reinterpret_as_s32(q3)), scale, offset));
+}
+#endif
+
+void packImageToTensor(const cv::Mat& image, float* tensor, const float scale[3], const float offset[3], bool swapRB)
+{
+	packImageToTensor(image, tensor, image.size(), cv::Point(0, 0), scale, offset, swapRB);
+}
+
+void packImageToTensor(const cv::Mat& image, float* tensor, const cv::Size& planeSize, const cv::Point& origin, const float scale[3],
+					   const float offset[3], bool swapRB)
+{
+	CV_Assert(image.depth() == CV_8U && (image.channels() == 3 || image.channels() == 4));
+	CV_Assert(cv::Rect(origin, image.size()) == (cv::Rect(origin, image.size()) & cv::Rect(cv::Point(0, 0), planeSize)));
+
+	const int channels = image.channels();
+	const int width = image.cols;
+	const size_t planeArea = (size_t)planeSize.area();
+
+	// Source channel feeding each output plane
+	const int blueIndex = swapRB ? 2 : 0;
+	const int redIndex = swapRB ? 0 : 2;
+	const size_t originOffset = (size_t)origin.y * planeSize.width + origin.x;
+	float* bluePlane = tensor + blueIndex * planeArea + originOffset;
+	float* greenPlane = tensor + planeArea + originOffset;
+	float* redPlane = tensor + redIndex * planeArea + originOffset;
+	const float blueScale = scale[blueIndex], blueOffset = offset[blueIndex];
+	const float greenScale = scale[1], greenOffset = offset[1];
+	const float redScale = scale[redIndex], redOffset = offset[redIndex];
+
+	for (int y = 0; y < image.rows; ++y)
+	{
+		const uint8_t* src = image.ptr<uint8_t>(y);
+		float* blue = bluePlane + (size_t)y * planeSize.width;
+		float* green = greenPlane + (size_t)y * planeSize.width;
+		float* red = redPlane + (size_t)y * planeSize.width;
+
+		int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+		{
+			using namespace cv;
+			const int lanes = VTraits<v_uint8>::vlanes();
+			const v_float32 vBlueScale = vx_setall_f32(blueScale), vBlueOffset = vx_setall_f32(blueOffset);
+			const v_float32 vGreenScale = vx_setall_f32(greenScale), vGreenOffset = vx_setall_f32(greenOffset);
+			const v_float32 vRedScale = vx_setall_f32(redScale), vRedOffset = vx_setall_f32(redOffset);
+
+			// Deinterleave a register worth of pixels, alpha is loaded and dropped
+			for (; x <= width - lanes; x += lanes)
+			{
+				v_uint8 b, g, r, a;
+				if (channels == 4) v_load_deinterleave(src + x * 4, b, g, r, a);
+				else v_load_deinterleave(src + x * 3, b, g, r);
+
+				storeScaled(b, blue + x, vBlueScale, vBlueOffset);
+				storeScaled(g, green + x, vGreenScale, vGreenOffset);
+				storeScaled(r, red + x, vRedScale, vRedOffset);
+			}
+			vx_cleanup();
+		}
+#endif
+		for (; x < width; ++x)
+		{
+			const uint8_t* pixel = src + x * channels;
+			blue[x] = pixel[0] * blueScale + blueOffset;
+			green[x] = pixel[1] * greenScale + greenOffset;
+			red[x] = pixel[2] * redScale + redOffset;
+		}
+	}
+}
+
+void ImagePreProcessor::SetConfig(const PreProcessConfig& config)
+{
+	_config = config;
+
+	// Padding depends on the normalization, force a refill
+	std::fill(_imageRects.begin(), _imageRects.end(), cv::Rect());
+}
+
+void ImagePreProcessor::SetLetterbox(bool letterbox)
+{
+	_config.letterbox = letterbox;
+	std::fill(_imageRects.begin(), _imageRects.end(), cv::Rect());
+}
+
+void ImagePreProcessor::Process(const cv::Mat& image, const cv::Size& inputSize)
+{
+	ProcessBatch(&image, 1, inputSize);
+}
+
+void ImagePreProcessor::ProcessBatch(const cv::Mat* images, int count, const cv::Size& inputSize)
+{
+	// Same shape keeps the same buffer, anything written before (e.g. the padding) is lost otherwise
+	const int blobSize[] = { count, 3, inputSize.height, inputSize.width };
+	const bool sameShape = _blob.dims == 4 && _blob.type() == CV_32F && std::equal(blobSize, blobSize + 4, _blob.size.p);
+	_blob.create(4, blobSize, CV_32F);
+	if (!sameShape) _imageRects.clear();
+
+	_inputSize = inputSize;
+	_imageRects.resize(count);
+	_scales.resize(count);
+	_paddings.resize(count);
+	const size_t itemSize = 3 * (size_t)inputSize.area();
+	for (int i = 0; i < count; ++i)
+	{
+		const cv::Mat& image = images[i];
+
+		// Stretch to the input, or fit it while keeping the aspect ratio
+		cv::Rect imageRect(cv::Point(0, 0), inputSize);
+		if (_config.letterbox)
+		{
+			const float fit = std::min((float)inputSize.width / image.cols, (float)inputSize.height / image.rows);
+			const cv::Size fitSize(std::max(1, (int)std::round(image.cols * fit)), std::max(1, (int)std::round(image.rows * fit)));
+			imageRect = cv::Rect((inputSize.width - fitSize.width) / 2, (inputSize.height - fitSize.height) / 2, fitSize.width, fitSize.height);
+		}
+		_scales[i] = { (float)imageRect.width / image.cols, (float)imageRect.height / image.rows };
+		_paddings[i] = { (float)imageRect.x, (float)imageRect.y };
+
+		float* tensor = (float*)_blob.data + i * itemSize;
+		if (_config.mode == PREPROCESS_OPENCV)
+		{
+			processOpenCV(image, imageRect, tensor);
+			_imageRects[i] = cv::Rect();
+		}
+		else
+		{
+			processFused(image, imageRect, tensor, _imageRects[i]);
+		}
+	}
+}
+
+void ImagePreProcessor::processFused(const cv::Mat& image, const cv::Rect& imageRect, float* tensor, cv::Rect& previousImageRect)
+{
+	const cv::Size& inputSize = _inputSize;
+
+	// The padding never changes while the image keeps landing in the same place
+	if (imageRect.size() != inputSize && imageRect != previousImageRect)
+	{
+		const size_t planeArea = (size_t)inputSize.area();
+		for (int c = 0; c < 3; ++c)
+		{
+			std::fill(tensor + c * planeArea, tensor + (c + 1) * planeArea, _config.padValue * _config.scale[c] + _config.offset[c]);
+		}
+	}
+	previousImageRect = imageRect;
+
+	// Resize while still 8-bit, then normalize and pack in one pass
+	if (image.size() != imageRect.size()) cv::resize(image, _resized, imageRect.size());
+	const cv::Mat& resized = image.size() != imageRect.size() ? _resized : image;
+	packImageToTensor(resized, tensor, inputSize, imageRect.tl(), _config.scale, _config.offset, _config.swapRB);
+}
+
+void ImagePreProcessor::processOpenCV(const cv::Mat& image, const cv::Rect& imageRect, float* tensor)
+{
+	const cv::Size& inputSize = _inputSize;
+
+	cv::Mat input;
+	cv::resize(image, input, imageRect.size());
+	if (imageRect.size() != inputSize)
+	{
+		cv::copyMakeBorder(input, input, imageRect.y, inputSize.height - imageRect.br().y, imageRect.x, inputSize.width - imageRect.br().x,
+						   cv::BORDER_CONSTANT, cv::Scalar::all(_config.padValue));
+	}
+	if (input.channels() == 4) cv::cvtColor(input, input, cv::COLOR_BGRA2BGR);
+
+	// Scale and offset are per output channel, which are swapped with the source ones when swapRB is set
+	cv::Scalar scale, offset;
+	for (int c = 0; c < 3; ++c)
+	{
+		const int outputChannel = _config.swapRB ? 2 - c : c;
+		scale[c] = _config.scale[outputChannel];
+		offset[c] = _config.offset[outputChannel];
+	}
+	input.convertTo(_floatImage, CV_32F);
+	cv::multiply(_floatImage, scale, _floatImage);
+	cv::add(_floatImage, offset, _floatImage);
+	_openCVBlob = cv::dnn::blobFromImage(_floatImage, 1.0, cv::Size(), cv::Scalar(), _config.swapRB, false);
+
+	// Lands in its slot of the (batch) blob
+	std::memcpy(tensor, _openCVBlob.ptr<float>(), 3 * (size_t)inputSize.area() * sizeof(float));
+}
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include <ml/inferenceExecutor.h>
+
+// Std dependencies
+#include <algorithm>
+
+InferenceExecutor::InferenceExecutor(size_t queueDepth) : _queueDepth(std::max<size_t>(queueDepth, 1))
+{
+	_worker = std::thread(&InferenceExecutor::workerLoop, this);
+}
+
+InferenceExecutor::~InferenceExecutor()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+		while (!_requests.empty())
+		{
+			drop(_requests.front());
+			_requests.pop_front();
+		}
+	}
+	_requestCondition.notify_all();
+	if (_worker.joinable()) _worker.join();
+}
+
+void InferenceExecutor::SetModel(PreProcessBoxDetectionBase* model)
+{
+	Cancel();
+	WaitIdle();
+
+	// Detections of the previous model are meaningless now
+	{
+		std::lock_guard<std::mutex> lock(_latestResultMutex);
+		_hasLatestResult = false;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_model = model;
+	_tiledDetector.SetModel(model);
+}
+
+void InferenceExecutor::SetTiling(bool enabled, const TilingConfig& config)
+{
+	Cancel();
+	WaitIdle();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_tiling = enabled;
+	_tiledDetector.SetConfig(config);
+}
+
+void InferenceExecutor::SetQueueDepth(size_t queueDepth)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_queueDepth = std::max<size_t>(queueDepth, 1);
+	while (_requests.size() > _queueDepth)
+	{
+		drop(_requests.front());
+		_requests.pop_front();
+	}
+}
+
+std::future<InferenceResult> InferenceExecutor::Submit(const FrameHandle& frame, const cv::Rect& rect, float confidenceThreshold, Callback callback)
+{
+	Request request;
+	request.frame = frame;
+	request.rect = rect;
+	request.confidenceThreshold = confidenceThreshold;
+	request.callback = std::move(callback);
+	request.submitTime = std::chrono::steady_clock::now();
+	std::future<InferenceResult> future = request.promise.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		// Drop oldest, a newer frame makes the queued ones pointless
+		while (_requests.size() >= _queueDepth)
+		{
+			drop(_requests.front());
+			_requests.pop_front();
+		}
+		_requests.push_back(std::move(request));
+		++_submittedCount;
+	}
+	_requestCondition.notify_one();
+	return future;
+}
+
+void InferenceExecutor::SubmitLatest(const FrameHandle& frame, const cv::Rect& rect, float confidenceThreshold)
+{
+	Submit(frame, rect, confidenceThreshold, [this](const InferenceResult& result)
+	{
+		std::lock_guard<std::mutex> lock(_latestResultMutex);
+		_latestResult = result;
+		_hasLatestResult = true;
+	});
+}
+
+bool InferenceExecutor::TakeLatestResult(InferenceResult& result)
+{
+	std::lock_guard<std::mutex> lock(_latestResultMutex);
+	if (!_hasLatestResult) return false;
+
+	// Swapped so both sides keep their detection buffers
+	std::swap(result, _latestResult);
+	_hasLatestResult = false;
+	return true;
+}
+
+bool InferenceExecutor::HasLatestResult()
+{
+	std::lock_guard<std::mutex> lock(_latestResultMutex);
+	return _hasLatestResult;
+}
+
+void InferenceExecutor::RunNow(const FrameHandle& frame, const cv::Rect& rect, float confidenceThreshold, std::vector<DetectionBox>& detections)
+{
+	WaitIdle();
+	infer(_model, frame, rect, confidenceThreshold, detections);
+}
+
+void InferenceExecutor::Cancel()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	while (!_requests.empty())
+	{
+		drop(_requests.front());
+		_requests.pop_front();
+	}
+	_idleCondition.notify_all();
+}
+
+void InferenceExecutor::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idleCondition.wait(lock, [this]() { return _requests.empty() && !_busy; });
+}
+
+void InferenceExecutor::drop(Request& request)
+{
+	InferenceResult result;
+	result.sequence = request.frame != nullptr ? request.frame->sequence : 0;
+	result.rect = request.rect;
+	result.dropped = true;
+	result.submitTime = request.submitTime;
+	result.finishTime = std::chrono::steady_clock::now();
+	request.promise.set_value(std::move(result));
+	++_droppedCount;
+}
+
+void InferenceExecutor::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_requestCondition.wait(lock, [this]() { return _stopping || !_requests.empty(); });
+		if (_stopping) break;
+
+		Request request = std::move(_requests.front());
+		_requests.pop_front();
+		PreProcessBoxDetectionBase* model = _model;
+		_busy = true;
+		lock.unlock();
+
+		InferenceResult result;
+		result.sequence = request.frame != nullptr ? request.frame->sequence : 0;
+		result.rect = request.rect;
+		result.submitTime = request.submitTime;
+		infer(model, request.frame, request.rect, request.confidenceThreshold, result.detections);
+		result.finishTime = std::chrono::steady_clock::now();
+
+		// The frame can go back to the pool before anyone looks at the results
+		request.frame = nullptr;
+		_lastLatency = std::chrono::duration<double, std::milli>(result.finishTime - result.submitTime).count();
+		if (request.callback) request.callback(result);
+		request.promise.set_value(std::move(result));
+		// Only counted once the result is out, HasPending stays true until HasLatestResult can see it
+		++_completedCount;
+
+		lock.lock();
+		_busy = false;
+		if (_requests.empty()) _idleCondition.notify_all();
+	}
+}
+
+void InferenceExecutor::infer(PreProcessBoxDetectionBase* model, const FrameHandle& frame, const cv::Rect& rect, float confidenceThreshold,
+							  std::vector<DetectionBox>& detections)
+{
+	detections.clear();
+	if (model == nullptr || frame == nullptr) return;
+
+	model->SetConfidenceThreshold(confidenceThreshold);
+	if (_tiling)
+	{
+		// Reused tile detections were filtered with the previous threshold
+		if (confidenceThreshold != _tiledThreshold) _tiledDetector.Invalidate();
+		_tiledThreshold = confidenceThreshold;
+		_tiledDetector.Inference(frame, rect, detections);
+	}
+	else
+	{
+		model->InferenceOnFrame(frame, rect, detections);
+	}
+}
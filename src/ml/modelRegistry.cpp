@@ -0,0 +1,51 @@
+#include <ml/modelRegistry.h>
+
+ModelRegistry::ModelRegistry()
+{
+	// Each task runs its model on its own InferenceExecutor thread, so several sessions run at once. The shared
+	// pools are sized like the previous per session setup, a single thread means no pool workers at all, every
+	// run executes on its executor thread and concurrent runs never wait on each other for pool threads
+	// (sessions with an execution profile opting out of them get pools of their own, sized by the profile)
+	Ort::ThreadingOptions threadingOptions;
+	threadingOptions.SetGlobalIntraOpNumThreads(1);
+	threadingOptions.SetGlobalInterOpNumThreads(1);
+	_env = Ort::Env(threadingOptions, OrtLoggingLevel::ORT_LOGGING_LEVEL_WARNING, "Default");
+}
+
+std::shared_ptr<Ort::Session> ModelRegistry::Acquire(const std::string& key, const std::function<void(Ort::Session&)>& create, bool& created)
+{
+	// Held while creating, so concurrent loads of the same model wait for the first one instead of loading it twice
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	created = false;
+	auto it = _sessions.find(key);
+	if (it != _sessions.end())
+	{
+		if (std::shared_ptr<Ort::Session> session = it->second.lock()) return session;
+	}
+
+	// Throws on failure, nothing is registered in that case
+	std::shared_ptr<Ort::Session> session = std::make_shared<Ort::Session>(nullptr);
+	create(*session);
+	_sessions[key] = session;
+	created = true;
+
+	// Drop the entries of sessions that were unloaded meanwhile
+	for (auto entry = _sessions.begin(); entry != _sessions.end();)
+	{
+		entry = entry->second.expired() ? _sessions.erase(entry) : std::next(entry);
+	}
+	return session;
+}
+
+size_t ModelRegistry::GetResidentCount()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	size_t count = 0;
+	for (const auto& entry : _sessions)
+	{
+		if (!entry.second.expired()) ++count;
+	}
+	return count;
+}
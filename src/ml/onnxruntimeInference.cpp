@@ -2,33 +2,197 @@
 
 #include <opencv2/imgproc.hpp>
 
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <string>
+
+#include <onnxruntime_session_options_config_keys.h>
 
 #include <ml/onnxruntimeInference.h>
+#include <ml/boxDecoders.h>
+#include <ml/modelRegistry.h>
+#include <system/mappedFile.h>
+
+// FNV-1a over 8 byte words (the tail byte by byte), good enough to tell cached models apart
+static uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+	const uint64_t prime = 1099511628211ull;
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		std::memcpy(&word, bytes + i, sizeof(uint64_t));
+		hash = (hash ^ word) * prime;
+	}
+	for (; i < size; ++i) hash = (hash ^ bytes[i]) * prime;
+
+	// Words only carry their bits upwards, fold the high bits back down
+	return hash ^ (hash >> 29) ^ (hash >> 47);
+}
+
+// Cached models are named <model stem>.<execution provider>-<machine>.<16 hex digit key>.ort
+static bool isCachedModelOf(const std::filesystem::path& file, const std::filesystem::path& modelPath, const std::string& provider)
+{
+	const std::string prefix = modelPath.stem().string() + "." + provider + ".";
+	const std::string name = file.filename().string();
+	return file.extension() == ".ort" && name.size() == prefix.size() + 20 && name.compare(0, prefix.size(), prefix) == 0;
+}
+
+std::string OnnxInferenceBase::getCacheProvider(bool useCuda) const
+{
+	// Tagged with the machine too, machines sharing a models folder don't evict each other's caches
+	const std::string machineKey = ExecutionProfileStore::GetMachineKey();
+	char machineString[9];
+	snprintf(machineString, sizeof(machineString), "%08x", static_cast<unsigned int>(hashBytes(machineKey.data(), machineKey.size())));
+
+	const std::string provider =
+		useCuda ? "cuda" + std::to_string(_cudaOptions.device_id) + "-" + std::to_string(_cudaOptions.cudnn_conv_algo_search) : "cpu";
+	return provider + "-" + machineString;
+}
+
+std::filesystem::path OnnxInferenceBase::GetCachedModelPath(const std::filesystem::path& modelPath, bool useCuda) const
+{
+	MappedFile modelFile;
+	if (!modelFile.Open(modelPath)) return {};
+
+	// Optimized graphs are only valid for the runtime, execution provider setup and machine that produced them
+	// (full optimization bakes in hardware specific layouts, e.g. NCHWc, so a shared models folder keeps one per machine)
+	const std::string provider = getCacheProvider(useCuda);
+	const std::string config = std::string(Ort::GetVersionString()) + "|" + provider + "|ort_enable_all|" + ExecutionProfileStore::GetMachineKey();
+
+	uint64_t key = hashBytes(modelFile.GetData(), modelFile.GetSize());
+	key = hashBytes(config.data(), config.size(), key);
+
+	char keyString[17];
+	snprintf(keyString, sizeof(keyString), "%016llx", static_cast<unsigned long long>(key));
+	std::filesystem::path cachedPath = modelPath;
+	cachedPath.replace_filename(modelPath.stem().string() + "." + provider + "." + keyString + ".ort");
+	return cachedPath;
+}
+
+void OnnxInferenceBase::createSession(const std::filesystem::path& modelPath, bool useCuda, Ort::Session& session)
+{
+	Ort::Env& env = ModelRegistry::GetInstance().GetEnv();
+	const std::filesystem::path cachedPath = _useModelCache ? GetCachedModelPath(modelPath, useCuda) : std::filesystem::path();
+	std::error_code error;
+
+	// Warm start, the cached graph is already optimized so the optimizers don't run again
+	if (!cachedPath.empty() && std::filesystem::exists(cachedPath, error))
+	{
+		try
+		{
+			Ort::SessionOptions cachedOptions = _sessionOptions.Clone();
+			cachedOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL);
+			session = Ort::Session(env, cachedPath.c_str(), cachedOptions);
+			_loadedFromCache = true;
+			return;
+		}
+		catch (Ort::Exception oe)
+		{
+			std::cout << "Discarding cached model " << cachedPath.string() << ": " << oe.what() << "\n";
+			std::filesystem::remove(cachedPath, error);
+		}
+	}
+
+	if (cachedPath.empty())
+	{
+		session = Ort::Session(env, modelPath.c_str(), _sessionOptions);
+		return;
+	}
+
+	// Cold start, optimize the source model and serialize the result (written aside and renamed
+	// once complete, so an interrupted load never leaves a broken cache behind)
+	std::filesystem::path writingPath = cachedPath;
+	writingPath += ".tmp";
+	try
+	{
+		Ort::SessionOptions cachingOptions = _sessionOptions.Clone();
+		cachingOptions.SetOptimizedModelFilePath(writingPath.c_str());
+		// The format would otherwise be picked from the (temporary) extension
+		cachingOptions.AddConfigEntry(kOrtSessionOptionsConfigSaveModelFormat, "ORT");
+		session = Ort::Session(env, modelPath.c_str(), cachingOptions);
+	}
+	catch (Ort::Exception oe)
+	{
+		// Most likely the model folder isn't writable, load without caching
+		std::cout << "Couldn't cache the optimized model: " << oe.what() << "\n";
+		std::filesystem::remove(writingPath, error);
+		session = Ort::Session(env, modelPath.c_str(), _sessionOptions);
+		return;
+	}
+
+	std::filesystem::rename(writingPath, cachedPath, error);
+	if (error)
+	{
+		std::filesystem::remove(writingPath, error);
+		return;
+	}
+
+	// Caches left behind by previous versions of the model (or of the runtime) for this execution provider are stale now,
+	// the other providers keep theirs (CPU and CUDA sessions of the same model alternate on the same machine)
+	const std::string provider = getCacheProvider(useCuda);
+	for (const auto& entry : std::filesystem::directory_iterator(cachedPath.parent_path(), error))
+	{
+		if (entry.path() != cachedPath && isCachedModelOf(entry.path(), modelPath, provider)) std::filesystem::remove(entry.path(), error);
+	}
+}
 
 bool OnnxInferenceBase::LoadModel(bool useCuda, const wchar_t* modelPath)
 {
-	// Initialize session options
-	setSessionOptions(useCuda);
+	// Profile tuned for this model and machine, unless one was given
+	if (!_hasExecutionProfile)
+	{
+		_executionProfile = ExecutionProfile();
+		if (ExecutionProfileStore::GetInstance().Find(std::filesystem::path(modelPath), useCuda, _executionProfile))
+		{
+			printf("Using tuned execution profile: %s\n", _executionProfile.ToString().c_str());
+		}
+	}
 
 	try
 	{
+		// Initialize session options (appending the CUDA provider throws on runtimes built without it)
+		setSessionOptions(useCuda);
+
 		printf("Loading ONNX Model from: %ls\n", modelPath);
 
-		// Model path is const wchar_t*
-		_session = Ort::Session(_env, modelPath, _sessionOptions);
+		// ORT takes native paths (wchar_t on Windows, char elsewhere)
+		const std::filesystem::path sourcePath = std::filesystem::absolute(std::filesystem::path(modelPath)).lexically_normal();
+
+		// Models loaded from the same file with the same options share their session
+		const std::string sessionKey = sourcePath.string() + (useCuda ? "|cuda" : "|cpu") + (_useModelCache ? "|optimized" : "|unoptimized") + "|" +
+									   _executionProfile.GetKey();
+		const auto loadStart = std::chrono::steady_clock::now();
+		bool created = false;
+		_loadedFromCache = false;
+		_session = ModelRegistry::GetInstance().Acquire(sessionKey, [&](Ort::Session& session) { createSession(sourcePath, useCuda, session); }, created);
+		_loadTime = created ? std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count() : 0.0;
+		if (created)
+		{
+			printf("Session created in %.1f ms (%s)\n", _loadTime,
+				   _loadedFromCache ? "warm, cached optimized model" : (_useModelCache ? "cold, optimized model cached" : "unoptimized, cache disabled"));
+		}
+		else
+		{
+			printf("Session already resident, shared\n");
+		}
 
 		// Local allocator
 		Ort::AllocatorWithDefaultOptions allocator;
 
 		// Get input count
-		assert(_session.GetInputCount() > 0);
+		assert(_session->GetInputCount() > 0);
 
 		// Get input name
-		Ort::AllocatedStringPtr inputName = _session.GetInputNameAllocated(0, allocator);
+		Ort::AllocatedStringPtr inputName = _session->GetInputNameAllocated(0, allocator);
 
 		// Get input type and shape
-		Ort::TypeInfo typeInfo = _session.GetInputTypeInfo(0);
+		Ort::TypeInfo typeInfo = _session->GetInputTypeInfo(0);
 		Ort::ConstTensorTypeAndShapeInfo tensorInfo = typeInfo.GetTensorTypeAndShapeInfo();
 		std::vector<int64_t> inputDims = tensorInfo.GetShape();
 
@@ -42,7 +206,16 @@ bool OnnxInferenceBase::LoadModel(bool useCuda, const wchar_t* modelPath)
 		printf(")\n");
 
 		_inputNodeDims = inputDims;
+		_inputShape = inputDims;
+		if (_inputShape[0] <= 0) _inputShape[0] = 1;
 		printf("Done!\n\n");
+
+		// Output shapes are known up-front for static models
+		_outputShapes.resize(_outputNodeNames.size());
+		for (size_t i = 0; i < _outputNodeNames.size(); ++i)
+		{
+			_outputShapes[i] = _session->GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
+		}
 	}
 	catch (Ort::Exception oe)
 	{
@@ -58,15 +231,122 @@ bool OnnxInferenceBase::LoadModel(bool useCuda, const wchar_t* modelPath)
 		std::cout << "ONNX exception caught: " << oe.what() << ", Code: " << oe.GetOrtErrorCode() << ".\n";
 		return false;
 	}
+
+	// Falls back to regular runs when outputs can't be bound
+	_ioBindingReady = bindOutputs();
+	printf("IoBinding: %s\n\n", _ioBindingReady ? "persistent buffers bound" : "not available, outputs are allocated per run");
 	return true;
 }
 
+bool OnnxInferenceBase::bindOutputs()
+{
+	_boundInputData = nullptr;
+	_outputBuffers.clear();
+	_outputValues.clear();
+
+	try
+	{
+		_ioBinding = Ort::IoBinding(*_session);
+		for (size_t i = 0; i < _outputNodeNames.size(); ++i)
+		{
+			// Dynamic or non float outputs can't be preallocated
+			Ort::TypeInfo typeInfo = _session->GetOutputTypeInfo(i);
+			Ort::ConstTensorTypeAndShapeInfo tensorInfo = typeInfo.GetTensorTypeAndShapeInfo();
+			if (tensorInfo.GetElementType() != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) return false;
+
+			size_t elementCount = 1;
+			for (int64_t dim : _outputShapes[i])
+			{
+				if (dim <= 0) return false;
+				elementCount *= dim;
+			}
+
+			_outputBuffers.emplace_back(elementCount);
+			_outputValues.emplace_back(Ort::Value::CreateTensor<float>(_memoryInfo, _outputBuffers.back().data(), elementCount,
+																	   _outputShapes[i].data(), _outputShapes[i].size()));
+			_ioBinding.BindOutput(_outputNodeNames[i], _outputValues.back());
+		}
+	}
+	catch (Ort::Exception oe)
+	{
+		std::cout << "ONNX exception caught: " << oe.what() << ", Code: " << oe.GetOrtErrorCode() << ".\n";
+		_outputBuffers.clear();
+		_outputValues.clear();
+		return false;
+	}
+	return true;
+}
+
+int OnnxInferenceBase::run(float* inputData, size_t inputSize, int64_t batchSize)
+{
+	// Only a dynamic batch dimension can change between runs
+	const bool shapeChanged = _inputShape[0] != batchSize;
+	_inputShape[0] = batchSize;
+
+	try
+	{
+		// Persistent outputs are written in place, the input only gets rebound if its buffer moved
+		if (IsUsingIoBinding())
+		{
+			if (inputData != _boundInputData || shapeChanged)
+			{
+				_inputValue = Ort::Value::CreateTensor<float>(_memoryInfo, inputData, inputSize, _inputShape.data(), _inputShape.size());
+				_ioBinding.BindInput(_inputNodeNames[0], _inputValue);
+				_boundInputData = inputData;
+			}
+			_session->Run(_runOptions, _ioBinding);
+		}
+		else
+		{
+			_inputValue = Ort::Value::CreateTensor<float>(_memoryInfo, inputData, inputSize, _inputShape.data(), _inputShape.size());
+			_boundInputData = nullptr;
+			_outputValues = _session->Run(_runOptions, _inputNodeNames.data(), &_inputValue, 1, _outputNodeNames.data(), _outputNodeNames.size());
+			for (size_t i = 0; i < _outputValues.size(); ++i)
+			{
+				_outputShapes[i] = _outputValues[i].GetTensorTypeAndShapeInfo().GetShape();
+			}
+		}
+	}
+	catch (Ort::Exception oe)
+	{
+		std::cout << "ONNX exception caught: " << oe.what() << ". Code: " << oe.GetOrtErrorCode() << ".\n";
+		return -1;
+	}
+
+	size_t elementCount = 1;
+	for (int64_t dim : _outputShapes[0]) elementCount *= dim;
+	return (int)elementCount;
+}
+
 void OnnxInferenceBase::setSessionOptions(bool useCuda)
 {
-	_sessionOptions.SetInterOpNumThreads(1);
-	_sessionOptions.SetIntraOpNumThreads(1);
-	// Optimization will take time and memory during startup
-	_sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL);
+	// Start over, the options are rebuilt on every load
+	_sessionOptions = Ort::SessionOptions();
+
+	// Sessions run on the global thread pools of the shared environment, unless the profile gives them their own
+	const ExecutionProfile& profile = _executionProfile;
+	if (profile.useGlobalThreadPools)
+	{
+		_sessionOptions.DisablePerSessionThreads();
+	}
+	else
+	{
+		_sessionOptions.SetIntraOpNumThreads(profile.intraOpThreads);
+		_sessionOptions.SetInterOpNumThreads(profile.interOpThreads);
+		_sessionOptions.AddConfigEntry(kOrtSessionOptionsConfigAllowIntraOpSpinning, profile.allowSpinning ? "1" : "0");
+		_sessionOptions.AddConfigEntry(kOrtSessionOptionsConfigAllowInterOpSpinning, profile.allowSpinning ? "1" : "0");
+
+		const std::string affinities = profile.GetAffinityString();
+		if (!affinities.empty()) _sessionOptions.AddConfigEntry(kOrtSessionOptionsConfigIntraOpThreadAffinities, affinities.c_str());
+	}
+	_sessionOptions.SetExecutionMode(profile.parallelExecution ? ExecutionMode::ORT_PARALLEL : ExecutionMode::ORT_SEQUENTIAL);
+	if (profile.memoryPattern) _sessionOptions.EnableMemPattern();
+	else _sessionOptions.DisableMemPattern();
+	if (profile.cpuArena) _sessionOptions.EnableCpuMemArena();
+	else _sessionOptions.DisableCpuMemArena();
+
+	// Optimization takes time and memory during startup, it's only worth it when the result gets cached
+	_sessionOptions.SetGraphOptimizationLevel(_useModelCache ? GraphOptimizationLevel::ORT_ENABLE_ALL : GraphOptimizationLevel::ORT_DISABLE_ALL);
 
 	// CUDA options. If used.
 	if (useCuda)
@@ -80,217 +360,233 @@ void OnnxInferenceBase::setSessionOptions(bool useCuda)
 	}
 }
 
-int PreProcessBoxDetectionBase::Inference(cv::Mat& image, std::vector<Ort::Value>& outputTensor)
+bool PreProcessBoxDetectionBase::preProcess(cv::Mat& image)
 {
-	std::vector<Ort::Value> inputTensor;
-	bool error = preProcess(image, inputTensor);
-	if (!error) return NULL;
-	try
+	if (_inputNodeDims.size() < 4 || image.empty()) return false;
+
+	// this will make the input into (1,3,_imageWidth,_imageHeight) - usually (1,3,640,640)
+	int64_t _imageWidth = _inputNodeDims[2];
+	int64_t _imageHeight = _inputNodeDims[3];
+	_preProcessor.Process(image, cv::Size(_imageWidth, _imageHeight));
+	return true;
+}
+
+int PreProcessBoxDetectionBase::Inference(cv::Mat& image)
+{
+	if (!preProcess(image)) return -1;
+
+	// The blob keeps its buffer across frames, so the bound input stays valid
+	cv::Mat& blob = _preProcessor.GetBlob();
+	return run((float*)blob.data, blob.total());
+}
+
+void PreProcessBoxDetectionBase::Inference(cv::Mat& frame, std::vector<DetectionBox>& detectionBoxes)
+{
+	if (Inference(frame) == -1) return;
+	decode(0, detectionBoxes);
+}
+
+bool PreProcessBoxDetectionBase::PrepareInput(cv::Mat& frame, cv::Mat& tensor)
+{
+	if (!preProcess(frame)) return false;
+	tensor = _preProcessor.GetBlob();
+	return true;
+}
+
+// Boxes of a pyramid level back to full resolution
+static void scaleBoxes(std::vector<DetectionBox>& detectionBoxes, const cv::Vec2f& scale)
+{
+	for (auto& box : detectionBoxes)
 	{
-		outputTensor = _session.Run(Ort::RunOptions{nullptr}, _inputNodeNames.data(),
-			inputTensor.data(), inputTensor.size(), _outputNodeNames.data(), _outputNodeNames.size());
+		box.x *= scale[0];
+		box.y *= scale[1];
+		box.w *= scale[0];
+		box.h *= scale[1];
 	}
-	catch (Ort::Exception oe)
+}
+
+bool PreProcessBoxDetectionBase::getLevelView(const FrameHandle& frame, const cv::Rect& rect, cv::Mat& levelView, cv::Vec2f& levelScale) const
+{
+	const cv::Rect imageRect = (rect & frame->region) - frame->region.tl();
+	if (frame->image.empty() || imageRect.empty() || _inputNodeDims.size() < 4) return false;
+
+	// Halve the image for as long as it stays larger than the model input (dynamic inputs stay at full resolution)
+	const int64_t inputWidth = _inputNodeDims[2];
+	const int64_t inputHeight = _inputNodeDims[3];
+	int level = 0;
+	if (inputWidth > 0 && inputHeight > 0)
 	{
-		std::cout << "ONNX exception caught: " << oe.what() << ". Code: " << oe.GetOrtErrorCode() << ".\n";
-		return -1;
+		while ((imageRect.width >> (level + 1)) >= inputWidth && (imageRect.height >> (level + 1)) >= inputHeight) ++level;
 	}
-	auto info = outputTensor[0].GetTensorTypeAndShapeInfo();
-	return info.GetElementCount();
+
+	cv::Mat levelImage = frame->GetPyramidLevel(level);
+	const cv::Rect levelRect = cv::Rect(imageRect.x >> level, imageRect.y >> level, imageRect.width >> level, imageRect.height >> level) &
+							   cv::Rect(0, 0, levelImage.cols, levelImage.rows);
+	if (levelRect.empty()) return false;
+
+	levelView = levelImage(levelRect);
+	levelScale = { (float)imageRect.width / levelRect.width, (float)imageRect.height / levelRect.height };
+	return true;
 }
 
-void YOLOv8::Inference(cv::Mat& image, std::vector<DetectionBox>& detectionBoxes)
+void PreProcessBoxDetectionBase::InferenceOnFrame(const FrameHandle& frame, const cv::Rect& rect, std::vector<DetectionBox>& detectionBoxes)
 {
-	int elementCount = PreProcessBoxDetectionBase::Inference(image, _outputTensor);
-	if (elementCount == -1) return;
+	cv::Mat levelView;
+	cv::Vec2f levelScale;
+	if (!getLevelView(frame, rect, levelView, levelScale))
+	{
+		detectionBoxes.clear();
+		return;
+	}
 
-	_outputScaling = { (float)image.cols / _inputNodeDims[2], (float)image.rows / _inputNodeDims[3] };
+	Inference(levelView, detectionBoxes);
+	scaleBoxes(detectionBoxes, levelScale);
+}
 
-	// Get the output tensor
-	std::vector<int64_t> outputTensorShape = _outputTensor[0].GetTensorTypeAndShapeInfo().GetShape();
-	float* outputData = _outputTensor[0].GetTensorMutableData<float>();
+void PreProcessBoxDetectionBase::InferenceBatch(const std::vector<cv::Mat>& images, std::vector<std::vector<DetectionBox>>& detectionBoxes)
+{
+	detectionBoxes.resize(images.size());
 
-	// Transpose: [bs, features, preds_num] => [bs, preds_num, features]
-	cv::Mat outputMat = cv::Mat(cv::Size((int)outputTensorShape[2], (int)outputTensorShape[1]), CV_32F, outputData).t();
+	// Static batch models (or a single image) take the regular path
+	if (!SupportsBatching() || images.size() == 1)
+	{
+		for (size_t i = 0; i < images.size(); ++i)
+		{
+			cv::Mat image = images[i];
+			detectionBoxes[i].clear();
+			Inference(image, detectionBoxes[i]);
+		}
+		return;
+	}
 
-	int geomStride = 4; // number of geometry parameters {x, y, w, h}
-	int dataWidth = _classNumber + geomStride;
-	int rows = outputMat.rows;
-	float* pData = (float*)outputMat.data;
+	// Empty images get no detections, the others are packed together
+	_batchItems.clear();
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		detectionBoxes[i].clear();
+		if (!images[i].empty()) _batchItems.push_back((int)i);
+	}
+	if (_inputNodeDims.size() < 4) return;
 
-	// Update detections
-	detectionBoxes.clear();
-	for (int r = 0; r < rows; ++r)
+	const cv::Size inputSize((int)_inputNodeDims[2], (int)_inputNodeDims[3]);
+	for (size_t begin = 0; begin < _batchItems.size(); begin += _maxBatchSize)
 	{
-		cv::Mat scores(1, _classNumber, CV_32FC1, pData + geomStride);
-		cv::Point classId;
-		double maxConf;
-		minMaxLoc(scores, nullptr, &maxConf, nullptr, &classId);
+		const int count = (int)std::min<size_t>(_maxBatchSize, _batchItems.size() - begin);
+		_batchPacked.resize(count);
+		for (int i = 0; i < count; ++i)
+		{
+			_batchPacked[i] = images[_batchItems[begin + i]];
+		}
+
+		// One tensor for the whole batch, then the outputs of each item go back to its image
+		_preProcessor.ProcessBatch(_batchPacked.data(), count, inputSize);
+		cv::Mat& blob = _preProcessor.GetBlob();
+		if (run((float*)blob.data, blob.total(), count) == -1) continue;
 
-		if (maxConf > _confidenceThreshold)
+		for (int i = 0; i < count; ++i)
 		{
-			// Extract geometry
-			float xOrig = pData[0];
-			float yOrig = pData[1];
-			float wOrig = pData[2];
-			float hOrig = pData[3];
-
-			// Centralizing the bounding box
-			float x = (xOrig - wOrig * 0.5) * _outputScaling[0];
-			float y = (yOrig - hOrig * 0.5) * _outputScaling[1];
-			float w = wOrig * _outputScaling[0];
-			float h = hOrig * _outputScaling[1];
-
-			detectionBoxes.push_back({ x, y, w, h, classId.x });
+			decode(i, detectionBoxes[_batchItems[begin + i]]);
 		}
-		pData += dataWidth; // next pred
 	}
-
-	_outputTensor.clear();
 }
 
-bool YOLOv8::preProcess(cv::Mat& image, std::vector<Ort::Value>& inputTensor)
+void PreProcessBoxDetectionBase::InferenceBatchOnFrame(const FrameHandle& frame, const std::vector<cv::Rect>& rects,
+													   std::vector<std::vector<DetectionBox>>& detectionBoxes)
 {
-	int64_t _imageWidght = _inputNodeDims[2];
-	int64_t _imageHeight = _inputNodeDims[3];
-	// this will make the input into (1,3,_imageWidght,_imageHeight) - usually (1,3,640,640)
-	_blob = cv::dnn::blobFromImage(image, 1 / 255.0, cv::Size(_imageWidght, _imageHeight), cv::Scalar(0, 0, 0), true, false);
-	size_t inputTensorSize = _blob.total();
-	try
+	// Rects out of the frame are kept in place (with no detections) so indices still match
+	_batchImages.resize(rects.size());
+	_batchScales.resize(rects.size());
+	for (size_t i = 0; i < rects.size(); ++i)
 	{
-		inputTensor.emplace_back(Ort::Value::CreateTensor<float>(_memoryInfo, (float*)_blob.data, inputTensorSize, _inputNodeDims.data(),
-																 _inputNodeDims.size()));
+		if (!getLevelView(frame, rects[i], _batchImages[i], _batchScales[i])) _batchImages[i] = cv::Mat();
 	}
-	catch (Ort::Exception oe)
+
+	InferenceBatch(_batchImages, detectionBoxes);
+	for (size_t i = 0; i < rects.size(); ++i)
 	{
-		std::cout << "ONNX exception caught: " << oe.what() << ". Code: " << oe.GetOrtErrorCode() << ".\n";
-		return false;
+		if (_batchImages[i].empty()) detectionBoxes[i].clear();
+		else scaleBoxes(detectionBoxes[i], _batchScales[i]);
 	}
+}
+
+YOLOv8::YOLOv8(int classNumber, float confidenceThreshold) : PreProcessBoxDetectionBase(classNumber, confidenceThreshold, { "images" }, { "output0" })
+{
+	// Pixels in [0, 1], RGB
+	PreProcessConfig config;
+	config.swapRB = true;
+	_preProcessor.SetConfig(config);
+}
+
+bool YOLOv8::LoadModel(bool useCuda, const wchar_t* modelPath)
+{
+	_decoder = nullptr;
+	if (!PreProcessBoxDetectionBase::LoadModel(useCuda, modelPath)) return false;
+
+	// Exports are [bs, 4 + classes, preds_num], transposed ones [bs, preds_num, 4 + classes] (features being the smaller static dim)
+	const std::vector<int64_t>& outputShape = GetOutputShape(0);
+	if (outputShape.size() != 3) return true;
+	const int64_t features = outputShape[1], predictions = outputShape[2];
+	_outputLayout = features > 0 && (predictions <= 0 || features <= predictions) ? LAYOUT_CHANNEL_MAJOR : LAYOUT_PREDICTION_MAJOR;
+
+	const int64_t featureCount = _outputLayout == LAYOUT_CHANNEL_MAJOR ? features : predictions;
+	if (featureCount > 4) selectDecoder(std::min(_classNumber, (int)featureCount - 4));
 	return true;
 }
 
-void RF_DETR::Inference(cv::Mat& frame, std::vector<DetectionBox>& detectionBoxes)
+void YOLOv8::selectDecoder(int classCount)
 {
-	int elementCount = PreProcessBoxDetectionBase::Inference(frame, _outputTensor);
-	if (elementCount == -1) return;
+	bool specialized = false;
+	_decoder = selectYOLOv8Decoder(classCount, _boxEncoding, _outputLayout, &specialized);
+	_decoderClassCount = classCount;
+	printf("Decoder: %d classes (%s), %s, %s\n", classCount, specialized ? "specialized" : "generic", BoxEncodingNames[_boxEncoding],
+		   OutputLayoutNames[_outputLayout]);
+}
 
-	_outputScaling = { (float)frame.cols / _inputNodeDims[2], (float)frame.rows / _inputNodeDims[3] };
+void YOLOv8::decode(int batchIndex, std::vector<DetectionBox>& detectionBoxes)
+{
+	// Decoded as laid out by the model (no transpose)
+	const std::vector<int64_t>& outputTensorShape = GetOutputShape(0);
+	const bool channelMajor = _outputLayout == LAYOUT_CHANNEL_MAJOR;
+	const int featureCount = (int)outputTensorShape[channelMajor ? 1 : 2];
+	const int predictionCount = (int)outputTensorShape[channelMajor ? 2 : 1];
+	const float* output = GetOutputData(0) + (size_t)batchIndex * featureCount * predictionCount;
 
-	// Get predictions - output[0] is boxes, output[1] is logits
-	float* pred_boxes = _outputTensor[0].GetTensorMutableData<float>();
-	float* pred_logits = _outputTensor[1].GetTensorMutableData<float>();
-	
-	auto boxes_shape = _outputTensor[0].GetTensorTypeAndShapeInfo().GetShape();
-	auto logits_shape = _outputTensor[1].GetTensorTypeAndShapeInfo().GetShape();
-	
-	int num_queries = static_cast<int>(boxes_shape[1]);  // Number of object queries
-	int num_classes = static_cast<int>(logits_shape[2]); // Number of classes
-	
-	// Apply sigmoid to logits to get probabilities
-	std::vector<float> probs(num_queries * num_classes);
-	for (int i = 0; i < num_queries * num_classes; ++i) {
-		probs[i] = 1.0f / (1.0f + std::exp(-pred_logits[i]));
-	}
-	
-	// Select top 300 detections
-	const int num_select = std::min(300, num_queries * num_classes);
-	std::vector<std::pair<float, int>> prob_index_pairs;
-	
-	for (int i = 0; i < num_queries * num_classes; ++i) {
-		prob_index_pairs.emplace_back(probs[i], i);
-	}
-	
-	// Sort by probability (descending)
-	std::partial_sort(prob_index_pairs.begin(), prob_index_pairs.begin() + num_select,
-					  prob_index_pairs.end(), 
-					  [](const auto& a, const auto& b) { return a.first > b.first; });
-	
-	// Process top detections
-	detectionBoxes.clear();
-	for (int i = 0; i < num_select; ++i) {
-		float score = prob_index_pairs[i].first;
-		int topk_index = prob_index_pairs[i].second;
-		
-		if (score < _confidenceThreshold) continue;
-		
-		int box_idx = topk_index / num_classes;
-		int class_id = topk_index % num_classes;
-		
-		// Get box coordinates (center_x, center_y, width, height)
-		float cx = pred_boxes[box_idx * 4 + 0];
-		float cy = pred_boxes[box_idx * 4 + 1];
-		float w = pred_boxes[box_idx * 4 + 2];
-		float h = pred_boxes[box_idx * 4 + 3];
-		
-		// Clamp width and height to minimum 0
-		w = std::max(0.0f, w);
-		h = std::max(0.0f, h);
-		
-		// Convert from center-width-height to x1y1x2y2
-		float x1 = cx - 0.5f * w;
-		float y1 = cy - 0.5f * h;
-		float x2 = cx + 0.5f * w;
-		float y2 = cy + 0.5f * h;
-		
-		// Scale from relative [0,1] to absolute coordinates
-		x1 *= frame.cols;
-		y1 *= frame.rows;
-		x2 *= frame.cols;
-		y2 *= frame.rows;
-		
-		// Convert back to x,y,w,h format for DetectionBox
-		float final_x = x1;
-		float final_y = y1;
-		float final_w = x2 - x1;
-		float final_h = y2 - y1;
-		
-		DetectionBox box;
-		box.x = final_x;
-		box.y = final_y;
-		box.w = final_w;
-		box.h = final_h;
-		box.classId = class_id;
-		box.confidence = score;
-		
-		detectionBoxes.push_back(box);
-	}
-	
-	_outputTensor.clear();
+	const int classCount = std::min(_classNumber, featureCount - 4);
+	if (_decoder == nullptr || classCount != _decoderClassCount) selectDecoder(classCount);
+
+	// Boxes are mapped back from the input, undoing the resize (and letterbox padding)
+	_decoder(output, predictionCount, featureCount, classCount, _confidenceThreshold, _preProcessor.GetInputSize(), _preProcessor.GetScale(batchIndex),
+			 _preProcessor.GetPadding(batchIndex), detectionBoxes);
 }
 
-bool RF_DETR::preProcess(cv::Mat& frame, std::vector<Ort::Value>& inputTensor)
+RF_DETR::RF_DETR(int classNumber, float confidenceThreshold) : PreProcessBoxDetectionBase(classNumber, confidenceThreshold, { "input" }, { "dets", "labels" })
 {
-	int64_t _imageWidth = _inputNodeDims[2];
-	int64_t _imageHeight = _inputNodeDims[3];
-	
-	// Resize the image to the required dimensions
-	cv::Mat resized;
-	cv::resize(frame, resized, cv::Size(_imageWidth, _imageHeight));
-	
-	// Convert to float and normalize to [0, 1]
-	cv::Mat floatImg;
-	resized.convertTo(floatImg, CV_32F, 1.0 / 255.0);
-	
-	// Apply ImageNet normalization (means and stds)
-	cv::Scalar means(0.485, 0.456, 0.406);
-	cv::Scalar stds(0.229, 0.224, 0.225);
-	
-	cv::subtract(floatImg, means, floatImg);
-	cv::divide(floatImg, stds, floatImg);
-	
-	// Create blob with NCHW format
-	_blob = cv::dnn::blobFromImage(floatImg, 1.0, cv::Size(_imageWidth, _imageHeight), cv::Scalar(0, 0, 0), true, false);
-	
-	size_t inputTensorSize = _blob.total();
-	try
-	{
-		inputTensor.emplace_back(Ort::Value::CreateTensor<float>(_memoryInfo, (float*)_blob.data, inputTensorSize, _inputNodeDims.data(),
-																 _inputNodeDims.size()));
-	}
-	catch (Ort::Exception oe)
+	// Apply ImageNet normalization (means and stds, indexed by source BGR channel)
+	const float means[3] = { 0.485f, 0.456f, 0.406f };
+	const float stds[3] = { 0.229f, 0.224f, 0.225f };
+
+	// Output channel c (RGB) reads source channel 2 - c
+	PreProcessConfig config;
+	config.swapRB = true;
+	for (int c = 0; c < 3; ++c)
 	{
-		std::cout << "ONNX exception caught: " << oe.what() << ". Code: " << oe.GetOrtErrorCode() << ".\n";
-		return false;
+		config.scale[c] = 1.0f / (255.0f * stds[2 - c]);
+		config.offset[c] = -means[2 - c] / stds[2 - c];
 	}
-	return true;
+	_preProcessor.SetConfig(config);
+}
+
+void RF_DETR::decode(int batchIndex, std::vector<DetectionBox>& detectionBoxes)
+{
+	// Get predictions - output[0] is boxes, output[1] is logits
+	const std::vector<int64_t>& boxesShape = GetOutputShape(0);
+	const std::vector<int64_t>& logitsShape = GetOutputShape(1);
+	const int queryCount = static_cast<int>(boxesShape[1]);
+	const int classCount = static_cast<int>(logitsShape[2]);
+	const float* boxes = GetOutputData(0) + (size_t)batchIndex * queryCount * 4;
+	const float* logits = GetOutputData(1) + (size_t)batchIndex * queryCount * classCount;
+
+	// Select top 300 detections, boxes are relative to the input (undo the resize and letterbox padding)
+	decodeRFDETR(boxes, logits, queryCount, classCount, _confidenceThreshold, 300, _preProcessor.GetInputSize(), _preProcessor.GetScale(batchIndex),
+				 _preProcessor.GetPadding(batchIndex), _candidates, detectionBoxes);
 }
\ No newline at end of file
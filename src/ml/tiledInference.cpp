@@ -0,0 +1,193 @@
+#include <ml/tiledInference.h>
+
+// Std dependencies
+#include <algorithm>
+#include <cmath>
+
+// Tiles along one axis, spread evenly so the first starts at the begin and the last ends at the end
+// (returns the smallest overlap between neighbours)
+static int tileStarts(int begin, int length, int tileSize, float overlap, std::vector<int>& starts)
+{
+	starts.clear();
+	if (length <= tileSize)
+	{
+		starts.push_back(begin);
+		return 0;
+	}
+
+	const int stride = std::max(1, (int)std::lround(tileSize * (1.0f - overlap)));
+	const int count = (length - tileSize + stride - 1) / stride + 1;
+	int minOverlap = tileSize;
+	for (int i = 0; i < count; ++i)
+	{
+		starts.push_back(begin + (int)((int64_t)i * (length - tileSize) / (count - 1)));
+		if (i > 0) minOverlap = std::min(minOverlap, tileSize - (starts[i] - starts[i - 1]));
+	}
+	return minOverlap;
+}
+
+// Grows a span shorter than a tile around its center, staying within the bounds (as far as they allow)
+static void growToTileSize(int& begin, int& length, int tileSize, int boundsBegin, int boundsLength)
+{
+	if (length >= tileSize) return;
+
+	const int grownLength = std::min(tileSize, boundsLength);
+	begin = std::clamp(begin - (grownLength - length) / 2, boundsBegin, boundsBegin + boundsLength - grownLength);
+	length = grownLength;
+}
+
+TiledDetector::TiledDetector()
+{
+	// Neighbours see the same object whole (nearly identical boxes) or cut (a box contained in the whole one),
+	// both end up in a single box when merging over the smaller box
+	PostProcessConfig config;
+	config.mode = POSTPROCESS_MERGE;
+	config.classAware = true;
+	config.overlapThreshold = 0.5f;
+	_postProcessor.SetConfig(config);
+}
+
+void TiledDetector::SetModel(PreProcessBoxDetectionBase* model)
+{
+	if (_model == model) return;
+	_model = model;
+	Invalidate();
+}
+
+void TiledDetector::SetConfig(const TilingConfig& config)
+{
+	_config = config;
+	_config.tileSize = std::max(0, _config.tileSize);
+	_config.overlap = std::clamp(_config.overlap, 0.0f, 0.9f);
+
+	// Force a new layout, the overlap isn't part of the layout key
+	_tiles.clear();
+	_layoutTileSize = 0;
+}
+
+void TiledDetector::Invalidate()
+{
+	for (Tile& tile : _tiles)
+	{
+		tile.valid = false;
+	}
+}
+
+void TiledDetector::layoutTiles(const cv::Rect& rect, int tileSize)
+{
+	if (rect == _layoutRect && tileSize == _layoutTileSize && !_tiles.empty()) return;
+
+	_layoutRect = rect;
+	_layoutTileSize = tileSize;
+	_minOverlap.width = tileStarts(rect.x, rect.width, tileSize, _config.overlap, _xStarts);
+	_minOverlap.height = tileStarts(rect.y, rect.height, tileSize, _config.overlap, _yStarts);
+
+	_tiles.resize(_xStarts.size() * _yStarts.size());
+	size_t index = 0;
+	for (int y : _yStarts)
+	{
+		for (int x : _xStarts)
+		{
+			Tile& tile = _tiles[index++];
+			tile.rect = cv::Rect(x, y, tileSize, tileSize) & rect;
+			tile.valid = false;
+			tile.boxes.clear();
+		}
+	}
+}
+
+void TiledDetector::filterBorderBoxes(const Tile& tile, std::vector<DetectionBox>& boxes) const
+{
+	// Boxes cut by a border shared with another tile are dropped when they fit in the overlap,
+	// the neighbour sees them whole (larger ones are kept, so the post processor can merge their parts)
+	const float margin = 2.0f;
+	const bool hasLeft = tile.rect.x > _layoutRect.x;
+	const bool hasTop = tile.rect.y > _layoutRect.y;
+	const bool hasRight = tile.rect.br().x < _layoutRect.br().x;
+	const bool hasBottom = tile.rect.br().y < _layoutRect.br().y;
+
+	auto isCut = [&](const DetectionBox& box)
+	{
+		const bool fitsX = box.w < _minOverlap.width;
+		const bool fitsY = box.h < _minOverlap.height;
+		return (hasLeft && fitsX && box.x <= margin) || (hasTop && fitsY && box.y <= margin) ||
+			   (hasRight && fitsX && box.x + box.w >= tile.rect.width - margin) || (hasBottom && fitsY && box.y + box.h >= tile.rect.height - margin);
+	};
+	boxes.erase(std::remove_if(boxes.begin(), boxes.end(), isCut), boxes.end());
+}
+
+void TiledDetector::Inference(const FrameHandle& frame, const cv::Rect& rect, std::vector<DetectionBox>& detectionBoxes)
+{
+	detectionBoxes.clear();
+	_runTileCount = 0;
+
+	const cv::Rect frameRect = frame != nullptr ? rect & frame->region : cv::Rect();
+	if (_model == nullptr || frameRect.empty() || frame->image.empty()) return;
+
+	// Square tiles at the model input size by default, each runs without resizing
+	int tileSize = _config.tileSize;
+	if (tileSize <= 0)
+	{
+		const std::vector<int64_t>& inputShape = _model->GetInputShape();
+		tileSize = inputShape.size() == 4 && inputShape[3] > 0 ? (int)inputShape[3] : 640;
+	}
+
+	// Tiles are always full size (the model would stretch the short ones), a rect smaller than a tile grows
+	// into the frame around it and the detections outside of the rect are dropped in the end
+	cv::Rect layoutRect = frameRect;
+	growToTileSize(layoutRect.x, layoutRect.width, tileSize, frame->region.x, frame->region.width);
+	growToTileSize(layoutRect.y, layoutRect.height, tileSize, frame->region.y, frame->region.height);
+	layoutTiles(layoutRect, tileSize);
+
+	// Pick the tiles to run, the others keep their detections
+	_runTiles.clear();
+	_tileImages.clear();
+	_paddedTiles.resize(_tiles.size());
+	for (int i = 0; i < (int)_tiles.size(); ++i)
+	{
+		const Tile& tile = _tiles[i];
+		if (_config.selection == TILES_CHANGED && tile.valid && !frame->HasChangedSince(tile.rect, tile.sequence)) continue;
+
+		_runTiles.push_back(i);
+		if (tile.rect.width == tileSize && tile.rect.height == tileSize)
+		{
+			_tileImages.push_back(frame->View(tile.rect));
+		}
+		else
+		{
+			// Only when the frame itself is smaller than a tile, padded at the bottom right so boxes keep their coordinates
+			cv::copyMakeBorder(frame->View(tile.rect), _paddedTiles[i], 0, tileSize - tile.rect.height, 0, tileSize - tile.rect.width,
+							   cv::BORDER_CONSTANT, cv::Scalar::all(0));
+			_tileImages.push_back(_paddedTiles[i]);
+		}
+	}
+	_runTileCount = (int)_runTiles.size();
+
+	if (!_runTiles.empty())
+	{
+		_model->InferenceBatch(_tileImages, _tileBoxes);
+		for (size_t i = 0; i < _runTiles.size(); ++i)
+		{
+			Tile& tile = _tiles[_runTiles[i]];
+			tile.boxes.swap(_tileBoxes[i]);
+			filterBorderBoxes(tile, tile.boxes);
+			tile.sequence = frame->sequence;
+			tile.valid = true;
+		}
+	}
+
+	// Back to rect coordinates, then the duplicates of neighbouring tiles are suppressed
+	const cv::Rect2f keptRect = cv::Rect2f(frameRect - rect.tl());
+	for (const Tile& tile : _tiles)
+	{
+		const cv::Point offset = tile.rect.tl() - rect.tl();
+		for (DetectionBox box : tile.boxes)
+		{
+			box.x += offset.x;
+			box.y += offset.y;
+			if (!keptRect.contains(cv::Point2f(box.x + box.w * 0.5f, box.y + box.h * 0.5f))) continue;
+			detectionBoxes.push_back(box);
+		}
+	}
+	_postProcessor.Process(detectionBoxes);
+}
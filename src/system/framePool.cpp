@@ -0,0 +1,73 @@
+#include <system/framePool.h>
+
+// Third party dependencies
+#include <opencv2/imgproc.hpp>
+
+cv::Mat Frame::GetPyramidLevel(int level) const
+{
+	if (level <= 0 || image.empty()) return image;
+
+	std::lock_guard<std::mutex> lock(pyramid.mutex);
+	if (pyramid.levels.size() < static_cast<size_t>(level)) pyramid.levels.resize(level);
+
+	// Each level is built from the previous one, so only the first one reads the full image
+	for (int i = pyramid.builtLevels; i < level; ++i)
+	{
+		const cv::Mat& source = i == 0 ? image : pyramid.levels[i - 1];
+		if (source.cols < 2 || source.rows < 2) return source;
+		cv::resize(source, pyramid.levels[i], cv::Size(source.cols / 2, source.rows / 2), 0, 0, cv::INTER_AREA);
+		pyramid.builtLevels = i + 1;
+	}
+	return pyramid.levels[level - 1];
+}
+
+FramePool::FramePool() : _storage(std::make_shared<Storage>()) {}
+
+Frame* FramePool::Acquire()
+{
+	std::lock_guard<std::mutex> lock(_storage->mutex);
+
+	// Reuse a frame no one is reading from
+	if (!_storage->freeFrames.empty())
+	{
+		Frame* frame = _storage->freeFrames.back();
+		_storage->freeFrames.pop_back();
+
+		// Levels belong to the previous capture
+		frame->pyramid.builtLevels = 0;
+		return frame;
+	}
+
+	// Otherwise grow the pool (only happens while readers hold on to every frame)
+	_storage->frames.push_back(std::make_unique<Frame>());
+	return _storage->frames.back().get();
+}
+
+FrameHandle FramePool::Publish(Frame* frame)
+{
+	// Deleter returns the buffer to the pool instead of freeing it
+	std::shared_ptr<Storage> storage = _storage;
+	return FrameHandle(frame, [storage](const Frame* releasedFrame)
+	{
+		std::lock_guard<std::mutex> lock(storage->mutex);
+		storage->freeFrames.push_back(const_cast<Frame*>(releasedFrame));
+	});
+}
+
+void FramePool::Recycle(Frame* frame)
+{
+	std::lock_guard<std::mutex> lock(_storage->mutex);
+	_storage->freeFrames.push_back(frame);
+}
+
+size_t FramePool::GetAllocationCount() const
+{
+	std::lock_guard<std::mutex> lock(_storage->mutex);
+	return _storage->frames.size();
+}
+
+size_t FramePool::GetFreeCount() const
+{
+	std::lock_guard<std::mutex> lock(_storage->mutex);
+	return _storage->freeFrames.size();
+}
@@ -0,0 +1,77 @@
+#include <system/frameSources/bitmapFrameSource.h>
+
+// Third party dependencies
+#include <opencv2/imgproc.hpp>
+
+cv::Mat WrapPixels(const PixelBuffer& pixels)
+{
+	if (pixels.data == nullptr) return cv::Mat();
+
+	switch (pixels.bitsPerPixel)
+	{
+	case 24: return cv::Mat(pixels.height, pixels.width, CV_8UC3, pixels.data, pixels.stride);
+	case 32: return cv::Mat(pixels.height, pixels.width, CV_8UC4, pixels.data, pixels.stride);
+	default: return cv::Mat();
+	}
+}
+
+bool CopyPixels(const PixelBuffer& pixels, const cv::Rect& region, cv::Mat& outFrame, FramePixelFormat format)
+{
+	cv::Mat bitmap = WrapPixels(pixels);
+	if (bitmap.empty()) return false;
+	bitmap = bitmap(region & cv::Rect(0, 0, bitmap.cols, bitmap.rows));
+
+	// Every path only reallocates the frame if its size or type doesn't match
+	const int channels = format == FRAME_FORMAT_BGRA ? 4 : 3;
+	if (bitmap.channels() == channels)
+	{
+		bitmap.copyTo(outFrame);
+	}
+	else
+	{
+		cv::cvtColor(bitmap, outFrame, channels == 4 ? cv::COLOR_BGR2BGRA : cv::COLOR_BGRA2BGR);
+	}
+	return true;
+}
+
+BitmapFrameSource::BitmapFrameSource(IBitmapProvider* provider, const cv::Rect& captureRect)
+	: _provider(provider), _captureRect(captureRect)
+{
+}
+
+BitmapFrameSource::~BitmapFrameSource()
+{
+	Close();
+	delete _provider;
+}
+
+bool BitmapFrameSource::Open()
+{
+	_allocatedSize = cv::Size();
+	return _provider != nullptr;
+}
+
+void BitmapFrameSource::Close()
+{
+	if (_allocatedSize.empty()) return;
+
+	_provider->Release();
+	_allocatedSize = cv::Size();
+}
+
+bool BitmapFrameSource::Capture(cv::Mat& outFrame, const cv::Rect& region)
+{
+	// Rebuild the bitmap only when the source resolution (or the frame format) changes
+	cv::Size sourceSize = _provider->GetSourceSize();
+	if (sourceSize != _allocatedSize || _pixelFormat != _allocatedFormat)
+	{
+		_provider->Release();
+		_allocatedSize = cv::Size();
+		if (sourceSize.empty() || !_provider->Allocate(sourceSize, _pixelFormat)) return false;
+		_allocatedSize = sourceSize;
+		_allocatedFormat = _pixelFormat;
+	}
+
+	if (!_provider->Grab(region)) return false;
+	return CopyPixels(_provider->GetPixels(), region, outFrame, _pixelFormat);
+}
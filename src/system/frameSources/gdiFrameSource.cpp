@@ -0,0 +1,103 @@
+#include <system/frameSources/gdiFrameSource.h>
+
+// Windows dependencies
+#include <wingdi.h>
+#include <winuser.h>
+#pragma comment(lib, "ws2_32.lib")
+
+static cv::Rect findMonitorRect(const char* adapterName)
+{
+	// Copy adapter name to monitor info
+    MONITORINFOEX monitorInfo;
+	monitorInfo.cbSize = sizeof(MONITORINFOEX);
+	strcpy_s(monitorInfo.szDevice, adapterName);
+
+	// Fetch size from adapter name
+	EnumDisplayMonitors(NULL, NULL, [](HMONITOR monitor, HDC, LPRECT, LPARAM lparam) -> BOOL
+	{
+		MONITORINFOEX* paramInfo = (MONITORINFOEX*)lparam;
+
+		MONITORINFOEX monitorInfo;
+		monitorInfo.cbSize = sizeof(MONITORINFOEX);
+		GetMonitorInfo(monitor, &monitorInfo);
+
+		if (strcmp(monitorInfo.szDevice, paramInfo->szDevice) == 0)
+		{
+			*paramInfo = monitorInfo;
+			return FALSE;
+		}
+
+		return TRUE;
+	}, (LPARAM)&monitorInfo);
+
+	const RECT& rect = monitorInfo.rcMonitor;
+	return cv::Rect(rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top);
+}
+
+cv::Size GdiBitmapProvider::GetSourceSize()
+{
+	return cv::Size(GetDeviceCaps(_srcHdc, HORZRES), GetDeviceCaps(_srcHdc, VERTRES));
+}
+
+bool GdiBitmapProvider::Allocate(const cv::Size& size, FramePixelFormat format)
+{
+	Release();
+
+    BITMAPINFO bi = {};
+    bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bi.bmiHeader.biWidth = size.width;
+    bi.bmiHeader.biHeight = -size.height; // Negative height to indicate top-down bitmap
+    bi.bmiHeader.biPlanes = 1;
+    bi.bmiHeader.biBitCount = format == FRAME_FORMAT_BGRA ? 32 : 24; // 8 bits per channel, BGRA matches the desktop layout
+    bi.bmiHeader.biCompression = BI_RGB;
+
+	void* bits = nullptr;
+	_memHdc = CreateCompatibleDC(_srcHdc);
+	_dibBitmap = CreateDIBSection(_memHdc, &bi, DIB_RGB_COLORS, &bits, NULL, 0);
+	if (_memHdc == nullptr || _dibBitmap == nullptr || bits == nullptr)
+	{
+		Release();
+		return false;
+	}
+	_oldBitmap = SelectObject(_memHdc, _dibBitmap);
+
+	// DIB rows are aligned to 4 bytes (always the case for 32-bit ones)
+	_pixels.data = (uint8_t*)bits;
+	_pixels.width = size.width;
+	_pixels.height = size.height;
+	_pixels.bitsPerPixel = bi.bmiHeader.biBitCount;
+	_pixels.stride = ((size.width * _pixels.bitsPerPixel + 31) / 32) * 4;
+	return true;
+}
+
+void GdiBitmapProvider::Release()
+{
+	if (_memHdc != nullptr)
+	{
+		if (_oldBitmap != nullptr) SelectObject(_memHdc, _oldBitmap);
+		DeleteDC(_memHdc);
+	}
+	if (_dibBitmap != nullptr)
+	{
+		DeleteObject(_dibBitmap);
+	}
+	_memHdc = nullptr;
+	_dibBitmap = nullptr;
+	_oldBitmap = nullptr;
+	_pixels = PixelBuffer();
+}
+
+bool GdiBitmapProvider::Grab(const cv::Rect& region)
+{
+	// Only blit what was asked for, the rest of the DIB keeps stale data
+	if (!BitBlt(_memHdc, region.x, region.y, region.width, region.height, _srcHdc, region.x, region.y, SRCCOPY)) return false;
+
+	// Make sure GDI is done writing before the DIB memory is read
+	GdiFlush();
+	return true;
+}
+
+GdiFrameSource::GdiFrameSource(HDC srcHdc, const char* adapterName)
+	: BitmapFrameSource(new GdiBitmapProvider(srcHdc), findMonitorRect(adapterName))
+{
+}
@@ -0,0 +1,279 @@
+#include <system/frameSources/mappedReplayFrameSource.h>
+
+// Std dependencies
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// Third party dependencies
+#include <opencv2/imgproc.hpp>
+
+// Copies recorded pixels out, converting them when the session was recorded in another format
+static void copyRecordedPixels(const cv::Mat& recorded, cv::Mat& outFrame, FramePixelFormat format)
+{
+	const int channels = format == FRAME_FORMAT_BGRA ? 4 : 3;
+	if (recorded.channels() == channels)
+	{
+		recorded.copyTo(outFrame);
+	}
+	else
+	{
+		cv::cvtColor(recorded, outFrame, channels == 4 ? cv::COLOR_BGR2BGRA : cv::COLOR_BGRA2BGR);
+	}
+}
+
+MappedReplayFrameSource::MappedReplayFrameSource(const std::filesystem::path& path, ReplayTiming timing, bool loop)
+	: _path(path), _file(std::make_shared<MappedFile>()), _timing(timing), _loop(loop)
+{
+	// Map up-front so the capture area is known before capture starts, copy-on-write since keyframes
+	// are handed out as writable Mats (a reader writing to one must not fault nor touch the file)
+	if (!_file->Open(_path, true) || _file->GetSize() < sizeof(SessionFileHeader)) return;
+
+	std::memcpy(&_header, _file->GetData(), sizeof(_header));
+	if (std::memcmp(_header.magic, SESSION_FILE_MAGIC, sizeof(_header.magic)) != 0 || _header.version != SESSION_VERSION)
+	{
+		std::cout << "Replay error! '" << _path.string() << "' is not a supported session file." << std::endl;
+		_header = {};
+		return;
+	}
+
+	_captureRect = cv::Rect(_header.originX, _header.originY, _header.frameWidth, _header.frameHeight);
+	if (_header.tileSize > 0)
+	{
+		_tileGrid = cv::Size((_header.frameWidth + _header.tileSize - 1) / _header.tileSize, (_header.frameHeight + _header.tileSize - 1) / _header.tileSize);
+	}
+	loadIndex();
+}
+
+bool MappedReplayFrameSource::Open()
+{
+	if (_index.empty())
+	{
+		std::cout << "Replay capture error! No frames found at '" << _path.string() << "'." << std::endl;
+		return false;
+	}
+
+	_nextFrame = 0;
+	_pendingKeyFrame = nullptr;
+	_canvas = cv::Mat::zeros(_captureRect.size(), _header.pixelType);
+	return true;
+}
+
+void MappedReplayFrameSource::Close()
+{
+	// The mapping stays alive for as long as published frames point into it
+	_canvas.release();
+	_pendingKeyFrame = nullptr;
+}
+
+bool MappedReplayFrameSource::IsFinished() const
+{
+	std::lock_guard<std::mutex> lock(_stepMutex);
+	return !_loop && _nextFrame >= _index.size();
+}
+
+void MappedReplayFrameSource::Step()
+{
+	{
+		std::lock_guard<std::mutex> lock(_stepMutex);
+		++_pendingSteps;
+	}
+	_stepCondition.notify_one();
+}
+
+cv::Point MappedReplayFrameSource::GetCursorPosition() const
+{
+	std::lock_guard<std::mutex> lock(_stepMutex);
+	return _cursorPosition;
+}
+
+bool MappedReplayFrameSource::Capture(cv::Mat& outFrame, const cv::Rect& region)
+{
+	_lastCaptureIsView = false;
+
+	// Wait to be let through, timing out so the capture loop can still be stopped
+	if (_timing == REPLAY_STEPPED)
+	{
+		std::unique_lock<std::mutex> lock(_stepMutex);
+		if (!_stepCondition.wait_for(lock, std::chrono::milliseconds(100), [this] { return _pendingSteps > 0; })) return false;
+		--_pendingSteps;
+	}
+
+	if (_nextFrame >= _index.size())
+	{
+		if (!_loop) return false;
+		_nextFrame = 0;
+	}
+
+	const SessionFrameHeader* header = getFrameHeader(_nextFrame);
+	if (header == nullptr) return false;
+
+	// Recorded timing is relative to the first frame handed out
+	if (_timing == REPLAY_RECORDED_TIMING)
+	{
+		const std::chrono::nanoseconds frameTime(header->timestamp - _index.front().timestamp);
+		if (_nextFrame == 0) _playbackStart = std::chrono::steady_clock::now();
+		std::this_thread::sleep_until(_playbackStart + frameTime);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_stepMutex);
+		_cursorPosition = cv::Point(header->cursorX, header->cursorY);
+		++_nextFrame;
+	}
+
+	const cv::Rect frameRegion = region & cv::Rect(cv::Point(0, 0), _captureRect.size());
+	const cv::Rect recordedRegion(header->regionX, header->regionY, header->regionWidth, header->regionHeight);
+	if (header->encoding == SESSION_FRAME_KEY)
+	{
+		applyKeyFrame(header);
+
+		// Hand out a view of the mapped pixels when the keyframe has everything that was asked for
+		if ((recordedRegion & frameRegion) == frameRegion)
+		{
+			uint8_t* pixels = getRecordedPixels(header);
+			const cv::Mat recordedFrame(recordedRegion.size(), _header.pixelType, pixels);
+			if (recordedFrame.channels() != (_pixelFormat == FRAME_FORMAT_BGRA ? 4 : 3))
+			{
+				copyRecordedPixels(recordedFrame(frameRegion - recordedRegion.tl()), outFrame, _pixelFormat);
+				return true;
+			}
+			outFrame = recordedFrame(frameRegion - recordedRegion.tl());
+			_lastCaptureIsView = true;
+			return true;
+		}
+	}
+	else
+	{
+		applyDeltaFrame(header);
+	}
+
+	// Anything else comes from the canvas, flushing a keyframe that wasn't copied yet
+	if (_pendingKeyFrame != nullptr)
+	{
+		const SessionFrameHeader* keyFrame = _pendingKeyFrame;
+		_pendingKeyFrame = nullptr;
+		const cv::Rect keyRegion(keyFrame->regionX, keyFrame->regionY, keyFrame->regionWidth, keyFrame->regionHeight);
+		uint8_t* pixels = getRecordedPixels(keyFrame);
+		cv::Mat(keyRegion.size(), _header.pixelType, pixels).copyTo(_canvas(keyRegion));
+	}
+	copyRecordedPixels(_canvas(frameRegion), outFrame, _pixelFormat);
+	return true;
+}
+
+void MappedReplayFrameSource::applyKeyFrame(const SessionFrameHeader* header)
+{
+	// A previous keyframe only needs to reach the canvas if this one doesn't replace it completely
+	if (_pendingKeyFrame != nullptr)
+	{
+		const cv::Rect pendingRegion(_pendingKeyFrame->regionX, _pendingKeyFrame->regionY, _pendingKeyFrame->regionWidth, _pendingKeyFrame->regionHeight);
+		const cv::Rect keyRegion(header->regionX, header->regionY, header->regionWidth, header->regionHeight);
+		if ((keyRegion & pendingRegion) != pendingRegion)
+		{
+			uint8_t* pixels = getRecordedPixels(_pendingKeyFrame);
+			cv::Mat(pendingRegion.size(), _header.pixelType, pixels).copyTo(_canvas(pendingRegion));
+		}
+	}
+	_pendingKeyFrame = header;
+}
+
+void MappedReplayFrameSource::applyDeltaFrame(const SessionFrameHeader* header)
+{
+	// Deltas build on top of the last keyframe
+	if (_pendingKeyFrame != nullptr)
+	{
+		const cv::Rect keyRegion(_pendingKeyFrame->regionX, _pendingKeyFrame->regionY, _pendingKeyFrame->regionWidth, _pendingKeyFrame->regionHeight);
+		uint8_t* pixels = getRecordedPixels(_pendingKeyFrame);
+		cv::Mat(keyRegion.size(), _header.pixelType, pixels).copyTo(_canvas(keyRegion));
+		_pendingKeyFrame = nullptr;
+	}
+
+	const cv::Rect recordedRegion(header->regionX, header->regionY, header->regionWidth, header->regionHeight);
+	const uint32_t* tileIndices = reinterpret_cast<const uint32_t*>(header + 1);
+	const uint8_t* pixels = reinterpret_cast<const uint8_t*>(header + 1) + alignSessionOffset(header->tileCount * sizeof(uint32_t));
+	const size_t pixelSize = _canvas.elemSize();
+	for (uint32_t tile = 0; tile < header->tileCount; ++tile)
+	{
+		const cv::Rect tileRect = getSessionTileRect(tileIndices[tile], _tileGrid, _header.tileSize, recordedRegion);
+		const size_t rowBytes = tileRect.width * pixelSize;
+		for (int row = 0; row < tileRect.height; ++row)
+		{
+			std::memcpy(_canvas.ptr(tileRect.y + row, tileRect.x), pixels, rowBytes);
+			pixels += rowBytes;
+		}
+	}
+}
+
+const SessionFrameHeader* MappedReplayFrameSource::getFrameHeader(size_t frameIndex) const
+{
+	const SessionIndexEntry& entry = _index[frameIndex];
+	if (entry.offset + sizeof(SessionFrameHeader) > _file->GetSize()) return nullptr;
+
+	const SessionFrameHeader* header = reinterpret_cast<const SessionFrameHeader*>(_file->GetData() + entry.offset);
+	if (entry.offset + sizeof(SessionFrameHeader) + header->payloadBytes > _file->GetSize()) return nullptr;
+	return header;
+}
+
+uint8_t* MappedReplayFrameSource::getRecordedPixels(const SessionFrameHeader* header) const
+{
+	return _file->GetWritableData() + (reinterpret_cast<const uint8_t*>(header + 1) - _file->GetData());
+}
+
+bool MappedReplayFrameSource::loadIndex()
+{
+	const uint8_t* data = _file->GetData();
+	const size_t size = _file->GetSize();
+
+	// Use the seek index when the recording was stopped properly
+	if (size >= sizeof(SessionFileHeader) + sizeof(SessionFileFooter))
+	{
+		SessionFileFooter footer;
+		std::memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+		// Footer values are untrusted, compared against what fits so nothing can overflow
+		if (std::memcmp(footer.magic, SESSION_INDEX_MAGIC, sizeof(footer.magic)) == 0 && footer.indexOffset <= size - sizeof(footer) &&
+			footer.indexCount <= (size - sizeof(footer) - footer.indexOffset) / sizeof(SessionIndexEntry))
+		{
+			_index.resize(footer.indexCount);
+			std::memcpy(_index.data(), data + footer.indexOffset, footer.indexCount * sizeof(SessionIndexEntry));
+			return true;
+		}
+	}
+
+	// Otherwise (e.g. the bot crashed mid recording) walk the chunks that made it to disk
+	std::cout << "Replay warning! '" << _path.string() << "' has no index, scanning its chunks." << std::endl;
+	uint64_t offset = sizeof(SessionFileHeader);
+	while (offset + sizeof(SessionChunkHeader) <= size)
+	{
+		SessionChunkHeader chunk;
+		std::memcpy(&chunk, data + offset, sizeof(chunk));
+		if (chunk.magic != SESSION_CHUNK_MAGIC || chunk.chunkBytes > size - offset - sizeof(chunk)) break;
+
+		// Records must stay within their chunk, a damaged frame count or payload size ends the walk
+		const uint64_t chunkEnd = offset + sizeof(chunk) + chunk.chunkBytes;
+		uint64_t recordOffset = offset + sizeof(chunk);
+		bool damaged = false;
+		for (uint32_t frame = 0; frame < chunk.frameCount; ++frame)
+		{
+			if (recordOffset + sizeof(SessionFrameHeader) > chunkEnd)
+			{
+				damaged = true;
+				break;
+			}
+			const SessionFrameHeader* header = reinterpret_cast<const SessionFrameHeader*>(data + recordOffset);
+			if (header->payloadBytes > chunkEnd - recordOffset - sizeof(SessionFrameHeader))
+			{
+				damaged = true;
+				break;
+			}
+			_index.push_back({ header->sequence, header->timestamp, recordOffset, header->encoding, 0 });
+			recordOffset = alignSessionOffset(recordOffset + sizeof(SessionFrameHeader) + header->payloadBytes);
+		}
+		if (damaged)
+		{
+			std::cout << "Replay warning! '" << _path.string() << "' has a damaged chunk, replaying the frames before it." << std::endl;
+			break;
+		}
+		offset += sizeof(chunk) + chunk.chunkBytes;
+	}
+	return !_index.empty();
+}
@@ -0,0 +1,76 @@
+#include <system/frameSources/replayFrameSource.h>
+
+// Std dependencies
+#include <algorithm>
+#include <iostream>
+
+// Third party dependencies
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+ReplayFrameSource::ReplayFrameSource(const std::filesystem::path& path, bool loop) : _path(path), _loop(loop)
+{
+	// Collect frames up-front so the capture area is known before capture starts
+	std::error_code error;
+	if (std::filesystem::is_directory(_path, error))
+	{
+		for (const auto& entry : std::filesystem::directory_iterator(_path, error))
+		{
+			std::string extension = entry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+			if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp")
+			{
+				_framePaths.push_back(entry.path());
+			}
+		}
+		std::sort(_framePaths.begin(), _framePaths.end());
+	}
+	else if (std::filesystem::is_regular_file(_path, error))
+	{
+		_framePaths.push_back(_path);
+	}
+
+	if (!_framePaths.empty())
+	{
+		cv::Mat firstFrame = cv::imread(_framePaths[0].string(), cv::IMREAD_COLOR);
+		_captureRect = cv::Rect(0, 0, firstFrame.cols, firstFrame.rows);
+	}
+}
+
+bool ReplayFrameSource::Open()
+{
+	if (_framePaths.empty())
+	{
+		std::cout << "Replay capture error! No frames found at '" << _path.string() << "'." << std::endl;
+		return false;
+	}
+
+	_nextFrame = 0;
+	return true;
+}
+
+void ReplayFrameSource::Close()
+{
+	_decodedFrame.release();
+}
+
+bool ReplayFrameSource::Capture(cv::Mat& outFrame, const cv::Rect& region)
+{
+	if (_nextFrame >= _framePaths.size())
+	{
+		if (!_loop) return false;
+		_nextFrame = 0;
+	}
+
+	// Single image replays don't need to be decoded over and over
+	if (_framePaths.size() > 1 || _decodedFrame.empty())
+	{
+		_decodedFrame = cv::imread(_framePaths[_nextFrame].string(), cv::IMREAD_COLOR);
+		if (_pixelFormat == FRAME_FORMAT_BGRA && !_decodedFrame.empty()) cv::cvtColor(_decodedFrame, _decodedFrame, cv::COLOR_BGR2BGRA);
+	}
+	++_nextFrame;
+
+	if (_decodedFrame.empty()) return false;
+	_decodedFrame(region & cv::Rect(0, 0, _decodedFrame.cols, _decodedFrame.rows)).copyTo(outFrame);
+	return true;
+}
@@ -0,0 +1,131 @@
+#include <system/frameSources/x11FrameSource.h>
+
+// Linux dependencies
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+// Std dependencies
+#include <iostream>
+
+// Internal dependencies
+#include <system/frameSources/bitmapFrameSource.h>
+
+X11FrameSource::X11FrameSource(const std::string& displayName) : _displayName(displayName)
+{
+	// Query the screen size up-front so coordinates can be mapped before capture starts
+	Display* display = XOpenDisplay(_displayName.empty() ? nullptr : _displayName.c_str());
+	if (display != nullptr)
+	{
+		Screen* screen = DefaultScreenOfDisplay(display);
+		_captureRect = cv::Rect(0, 0, WidthOfScreen(screen), HeightOfScreen(screen));
+		XCloseDisplay(display);
+	}
+}
+
+X11FrameSource::~X11FrameSource()
+{
+	Close();
+}
+
+bool X11FrameSource::Open()
+{
+	_display = XOpenDisplay(_displayName.empty() ? nullptr : _displayName.c_str());
+	if (_display == nullptr)
+	{
+		std::cout << "X11 capture error! Could not open display '" << _displayName << "'." << std::endl;
+		return false;
+	}
+
+	if (!XShmQueryExtension(_display))
+	{
+		std::cout << "X11 capture error! MIT-SHM extension is not available." << std::endl;
+		Close();
+		return false;
+	}
+
+	int screen = DefaultScreen(_display);
+	_rootWindow = RootWindow(_display, screen);
+	_captureRect = cv::Rect(0, 0, DisplayWidth(_display, screen), DisplayHeight(_display, screen));
+
+	// Shared image the X server writes into directly
+	_image = XShmCreateImage(_display, DefaultVisual(_display, screen), DefaultDepth(_display, screen), ZPixmap, nullptr, &_shmInfo,
+							 _captureRect.width, _captureRect.height);
+	if (_image == nullptr || _image->bits_per_pixel != 32)
+	{
+		std::cout << "X11 capture error! Only 32 bits per pixel visuals are supported." << std::endl;
+		Close();
+		return false;
+	}
+
+	_shmInfo.shmid = shmget(IPC_PRIVATE, _image->bytes_per_line * _image->height, IPC_CREAT | 0600);
+	if (_shmInfo.shmid < 0)
+	{
+		std::cout << "X11 capture error! Could not allocate shared memory segment." << std::endl;
+		Close();
+		return false;
+	}
+	void* sharedMemory = shmat(_shmInfo.shmid, nullptr, 0);
+	if (sharedMemory == (void*)-1)
+	{
+		std::cout << "X11 capture error! Could not map shared memory segment." << std::endl;
+		shmctl(_shmInfo.shmid, IPC_RMID, nullptr);
+		Close();
+		return false;
+	}
+	_shmInfo.shmaddr = _image->data = (char*)sharedMemory;
+	_shmInfo.readOnly = False;
+	_shmAttached = XShmAttach(_display, &_shmInfo);
+	XSync(_display, False);
+
+	// Mark the segment for removal, it goes away once both sides detach
+	shmctl(_shmInfo.shmid, IPC_RMID, nullptr);
+
+	if (!_shmAttached)
+	{
+		std::cout << "X11 capture error! Could not attach shared memory segment." << std::endl;
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void X11FrameSource::Close()
+{
+	if (_display == nullptr) return;
+
+	if (_shmAttached)
+	{
+		XShmDetach(_display, &_shmInfo);
+		_shmAttached = false;
+	}
+	if (_image != nullptr)
+	{
+		// Data belongs to the shared segment, don't let Xlib free it
+		_image->data = nullptr;
+		XDestroyImage(_image);
+		_image = nullptr;
+	}
+	if (_shmInfo.shmaddr != nullptr)
+	{
+		shmdt(_shmInfo.shmaddr);
+		_shmInfo.shmaddr = nullptr;
+	}
+
+	XCloseDisplay(_display);
+	_display = nullptr;
+}
+
+bool X11FrameSource::Capture(cv::Mat& outFrame, const cv::Rect& region)
+{
+	// The shared image always spans the whole screen, only the region is copied out of it
+	if (!XShmGetImage(_display, _rootWindow, _image, 0, 0, AllPlanes)) return false;
+
+	// Shared image is BGRX, the padding byte is dropped while copying out unless capturing BGRA
+	PixelBuffer pixels;
+	pixels.data = (uint8_t*)_image->data;
+	pixels.width = _image->width;
+	pixels.height = _image->height;
+	pixels.stride = _image->bytes_per_line;
+	pixels.bitsPerPixel = _image->bits_per_pixel;
+	return CopyPixels(pixels, region, outFrame, _pixelFormat);
+}
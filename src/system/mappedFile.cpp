@@ -0,0 +1,118 @@
+#include <system/mappedFile.h>
+
+// Std dependencies
+#include <iostream>
+
+#ifdef _WIN32
+// Windows dependencies
+#define NOMINMAX
+#include <windows.h>
+#else
+// Linux dependencies
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const std::filesystem::path& path, bool copyOnWrite)
+{
+	Close();
+
+	_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		_file = nullptr;
+		std::cout << "Failed to open '" << path.string() << "' for mapping." << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	_mapping = CreateFileMappingW(_file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+	if (_mapping == nullptr)
+	{
+		std::cout << "Failed to map '" << path.string() << "'." << std::endl;
+		Close();
+		return false;
+	}
+
+	_data = static_cast<uint8_t*>(MapViewOfFile(_mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+	if (_data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	_size = static_cast<size_t>(fileSize.QuadPart);
+	_copyOnWrite = copyOnWrite;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data != nullptr) UnmapViewOfFile(_data);
+	if (_mapping != nullptr) CloseHandle(_mapping);
+	if (_file != nullptr) CloseHandle(_file);
+	_data = nullptr;
+	_mapping = nullptr;
+	_file = nullptr;
+	_size = 0;
+	_copyOnWrite = false;
+}
+#else
+bool MappedFile::Open(const std::filesystem::path& path, bool copyOnWrite)
+{
+	Close();
+
+	_file = open(path.c_str(), O_RDONLY);
+	if (_file < 0)
+	{
+		std::cout << "Failed to open '" << path.string() << "' for mapping." << std::endl;
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(_file, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* data = copyOnWrite ? mmap(nullptr, fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, _file, 0)
+							 : mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, _file, 0);
+	if (data == MAP_FAILED)
+	{
+		std::cout << "Failed to map '" << path.string() << "'." << std::endl;
+		Close();
+		return false;
+	}
+
+	// Replays read front to back
+	madvise(data, fileStat.st_size, MADV_SEQUENTIAL);
+	_data = static_cast<uint8_t*>(data);
+	_size = static_cast<size_t>(fileStat.st_size);
+	_copyOnWrite = copyOnWrite;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data != nullptr) munmap(_data, _size);
+	if (_file >= 0) close(_file);
+	_data = nullptr;
+	_file = -1;
+	_size = 0;
+	_copyOnWrite = false;
+}
+#endif
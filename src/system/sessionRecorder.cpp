@@ -0,0 +1,300 @@
+#include <system/sessionRecorder.h>
+
+// Std dependencies
+#include <cstring>
+#include <iostream>
+
+// Internal dependencies
+#include <system/windowCaptureService.h>
+
+// Frames written together in a chunk (at most, the writer flushes whatever is queued)
+static constexpr size_t MAX_CHUNK_FRAMES = 32;
+
+SessionRecorder::~SessionRecorder()
+{
+	Stop();
+}
+
+bool SessionRecorder::Start(const std::filesystem::path& path, std::function<cv::Point()> cursorProvider)
+{
+	if (_recording) return false;
+
+	if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path());
+	_file.open(path, std::ios::binary | std::ios::trunc);
+	if (!_file.is_open())
+	{
+		std::cout << "Failed to open session file " << path.string() << std::endl;
+		return false;
+	}
+
+	_cursorProvider = std::move(cursorProvider);
+	_startTime = std::chrono::steady_clock::now();
+	_framesSinceKeyFrame = 0;
+	_headerWritten = false;
+	_fileOffset = 0;
+	_tileGrid = cv::Size();
+	_recordedTileStamps.clear();
+	_index.clear();
+	_recordedFrames = 0;
+	_droppedFrames = 0;
+	_writtenBytes = 0;
+	_queuedBytes = 0;
+	_failed = false;
+
+	_recording = true;
+	_writerThread = std::thread(&SessionRecorder::writerLoop, this);
+	_listenerId = WindowCaptureService::GetInstance().AddFrameListener([this](const FrameHandle& frame) { onFrame(frame); });
+	return true;
+}
+
+void SessionRecorder::Stop()
+{
+	if (!_recording) return;
+
+	// No new frames after this, the writer drains the queue before exiting
+	WindowCaptureService::GetInstance().RemoveFrameListener(_listenerId);
+	_listenerId = -1;
+	{
+		std::lock_guard<std::mutex> lock(_queueMutex);
+		_recording = false;
+	}
+	_queueCondition.notify_all();
+	if (_writerThread.joinable()) _writerThread.join();
+	_file.close();
+}
+
+void SessionRecorder::onFrame(const FrameHandle& frame)
+{
+	if (frame->image.empty() || _failed) return;
+
+	cv::Point cursor = _cursorProvider ? _cursorProvider() : cv::Point(0, 0);
+	const size_t frameBytes = frame->image.total() * frame->image.elemSize();
+	{
+		std::lock_guard<std::mutex> lock(_queueMutex);
+		if (_queue.size() >= _maxQueuedFrames || (!_queue.empty() && _queuedBytes + frameBytes > _maxQueuedBytes))
+		{
+			++_droppedFrames;
+			return;
+		}
+		_queue.push_back({ frame, cursor, frameBytes });
+		_queuedBytes += frameBytes;
+	}
+	_queueCondition.notify_one();
+}
+
+void SessionRecorder::writerLoop()
+{
+	std::vector<QueuedFrame> frames;
+	frames.reserve(MAX_CHUNK_FRAMES);
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_queueMutex);
+			_queueCondition.wait(lock, [this] { return !_queue.empty() || !_recording; });
+			if (_queue.empty()) break;
+
+			while (!_queue.empty() && frames.size() < MAX_CHUNK_FRAMES)
+			{
+				_queuedBytes -= _queue.front().bytes;
+				frames.push_back(std::move(_queue.front()));
+				_queue.pop_front();
+			}
+		}
+
+		// Frame handles are released as soon as their pixels are written
+		writeChunk(frames);
+		frames.clear();
+
+		// Give the queued frames back to the capture, the recording can't go on
+		if (_failed)
+		{
+			std::lock_guard<std::mutex> lock(_queueMutex);
+			_queue.clear();
+			_queuedBytes = 0;
+			return;
+		}
+	}
+
+	writeIndex();
+}
+
+void SessionRecorder::writeChunk(const std::vector<QueuedFrame>& frames)
+{
+	if (!_headerWritten)
+	{
+		const auto [captureMin, captureMax] = WindowCaptureService::GetInstance().GetCaptureDimensions();
+		const Frame& firstFrame = *frames.front().frame;
+
+		SessionFileHeader header = {};
+		std::memcpy(header.magic, SESSION_FILE_MAGIC, sizeof(header.magic));
+		header.version = SESSION_VERSION;
+		header.tileSize = firstFrame.tileSize;
+		header.frameWidth = captureMax.x - captureMin.x;
+		header.frameHeight = captureMax.y - captureMin.y;
+		header.originX = captureMin.x;
+		header.originY = captureMin.y;
+		header.pixelType = firstFrame.image.type();
+		write(&header, sizeof(header));
+		_headerWritten = true;
+	}
+
+	// Records are assembled in memory so the chunk goes out in a single write
+	_chunkBuffer.resize(sizeof(SessionChunkHeader));
+	for (const QueuedFrame& queued : frames)
+	{
+		encodeFrame(queued, _chunkBuffer);
+	}
+	_chunkBuffer.resize(alignSessionOffset(_chunkBuffer.size()));
+
+	SessionChunkHeader chunkHeader = {};
+	chunkHeader.magic = SESSION_CHUNK_MAGIC;
+	chunkHeader.frameCount = static_cast<uint32_t>(frames.size());
+	chunkHeader.chunkBytes = _chunkBuffer.size() - sizeof(SessionChunkHeader);
+	std::memcpy(_chunkBuffer.data(), &chunkHeader, sizeof(chunkHeader));
+	write(_chunkBuffer.data(), _chunkBuffer.size());
+}
+
+void SessionRecorder::encodeFrame(const QueuedFrame& queued, std::vector<uint8_t>& buffer)
+{
+	const Frame& frame = *queued.frame;
+	const size_t pixelSize = frame.image.elemSize();
+
+	// Tiles are tracked against what was recorded, a new grid means nothing is known yet
+	const bool hasTiles = frame.tileSize > 0 && !frame.tileStamps.empty();
+	if (frame.tileGrid != _tileGrid)
+	{
+		_tileGrid = frame.tileGrid;
+		_recordedTileStamps.assign(_tileGrid.area(), 0);
+		_framesSinceKeyFrame = _keyFrameInterval;
+	}
+
+	// Keyframes refresh every tile they fully cover, deltas only carry the tiles that moved on since
+	const bool isKeyFrame = !hasTiles || _framesSinceKeyFrame >= _keyFrameInterval;
+	_deltaTiles.clear();
+	if (hasTiles)
+	{
+		const cv::Rect tiles = cv::Rect(frame.region.x / frame.tileSize, frame.region.y / frame.tileSize,
+										(frame.region.br().x - 1) / frame.tileSize - frame.region.x / frame.tileSize + 1,
+										(frame.region.br().y - 1) / frame.tileSize - frame.region.y / frame.tileSize + 1) &
+							   cv::Rect(cv::Point(0, 0), _tileGrid);
+		for (int tileY = tiles.y; tileY < tiles.br().y; ++tileY)
+		{
+			for (int tileX = tiles.x; tileX < tiles.br().x; ++tileX)
+			{
+				const uint32_t tileIndex = tileY * _tileGrid.width + tileX;
+				const cv::Rect tileRect(tileX * frame.tileSize, tileY * frame.tileSize, frame.tileSize, frame.tileSize);
+
+				// Tiles cut by the region are only partially recorded, so they can't be marked as up to date
+				if ((tileRect & frame.region) != tileRect)
+				{
+					_deltaTiles.push_back(tileIndex);
+					continue;
+				}
+				if (isKeyFrame || frame.tileStamps[tileIndex] != _recordedTileStamps[tileIndex])
+				{
+					_deltaTiles.push_back(tileIndex);
+					_recordedTileStamps[tileIndex] = frame.tileStamps[tileIndex];
+				}
+			}
+		}
+	}
+	_framesSinceKeyFrame = isKeyFrame ? 1 : _framesSinceKeyFrame + 1;
+
+	SessionFrameHeader header = {};
+	header.sequence = frame.sequence;
+	header.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(frame.captureTime - _startTime).count();
+	header.cursorX = queued.cursor.x;
+	header.cursorY = queued.cursor.y;
+	header.regionX = frame.region.x;
+	header.regionY = frame.region.y;
+	header.regionWidth = frame.region.width;
+	header.regionHeight = frame.region.height;
+	header.encoding = isKeyFrame ? SESSION_FRAME_KEY : SESSION_FRAME_DELTA;
+	header.tileCount = isKeyFrame ? 0 : static_cast<uint32_t>(_deltaTiles.size());
+
+	// Payload size is known upfront so the buffer only grows once per frame
+	const uint64_t indicesBytes = isKeyFrame ? 0 : alignSessionOffset(_deltaTiles.size() * sizeof(uint32_t));
+	uint64_t pixelBytes = 0;
+	if (isKeyFrame)
+	{
+		pixelBytes = frame.region.area() * pixelSize;
+	}
+	else
+	{
+		for (uint32_t tileIndex : _deltaTiles)
+		{
+			pixelBytes += getSessionTileRect(tileIndex, _tileGrid, frame.tileSize, frame.region).area() * pixelSize;
+		}
+	}
+	header.payloadBytes = indicesBytes + pixelBytes;
+
+	const size_t recordOffset = alignSessionOffset(buffer.size());
+	buffer.resize(recordOffset + sizeof(header) + header.payloadBytes);
+	std::memcpy(buffer.data() + recordOffset, &header, sizeof(header));
+	uint8_t* payload = buffer.data() + recordOffset + sizeof(header);
+
+	// Copy out tightly packed rows (captured images might be strided)
+	auto copyRows = [&](const cv::Rect& rect)
+	{
+		const cv::Mat view = frame.View(rect);
+		const size_t rowBytes = rect.width * pixelSize;
+		for (int row = 0; row < view.rows; ++row)
+		{
+			std::memcpy(payload, view.ptr(row), rowBytes);
+			payload += rowBytes;
+		}
+	};
+
+	if (isKeyFrame)
+	{
+		copyRows(frame.region);
+	}
+	else
+	{
+		std::memcpy(payload, _deltaTiles.data(), _deltaTiles.size() * sizeof(uint32_t));
+		std::memset(payload + _deltaTiles.size() * sizeof(uint32_t), 0, indicesBytes - _deltaTiles.size() * sizeof(uint32_t));
+		payload += indicesBytes;
+		for (uint32_t tileIndex : _deltaTiles)
+		{
+			copyRows(getSessionTileRect(tileIndex, _tileGrid, frame.tileSize, frame.region));
+		}
+	}
+
+	// Chunk buffer starts at the current end of the file
+	_index.push_back({ header.sequence, header.timestamp, _fileOffset + recordOffset, header.encoding, 0 });
+	++_recordedFrames;
+}
+
+void SessionRecorder::writeIndex()
+{
+	if (!_headerWritten) return;
+
+	SessionFileFooter footer = {};
+	footer.indexOffset = _fileOffset;
+	footer.indexCount = _index.size();
+	std::memcpy(footer.magic, SESSION_INDEX_MAGIC, sizeof(footer.magic));
+
+	write(_index.data(), _index.size() * sizeof(SessionIndexEntry));
+	write(&footer, sizeof(footer));
+	if (!_failed && !_file.flush())
+	{
+		std::cout << "Session recording failed! Could not flush the session file." << std::endl;
+		_failed = true;
+	}
+}
+
+void SessionRecorder::write(const void* data, size_t size)
+{
+	if (_failed) return;
+
+	_file.write(static_cast<const char*>(data), size);
+	if (!_file)
+	{
+		// Nothing after this point makes it to the file, not even the index (the file isn't mistaken for a complete recording)
+		std::cout << "Session recording failed! Could not write to the session file (is the disk full?), recording stopped." << std::endl;
+		_failed = true;
+		return;
+	}
+	_fileOffset += size;
+	_writtenBytes += size;
+}
@@ -0,0 +1,50 @@
+#include <system/tileChangeTracker.h>
+
+// Std dependencies
+#include <cstring>
+
+void TileChangeTracker::Update(const cv::Mat& image, const cv::Rect& region, const cv::Size& frameSize, uint64_t sequence)
+{
+	// Start over (everything changed) when the capture size or format changes
+	if (_reference.size() != frameSize || _reference.type() != image.type())
+	{
+		_reference.create(frameSize, image.type());
+		_tileGrid = cv::Size((frameSize.width + _tileSize - 1) / _tileSize, (frameSize.height + _tileSize - 1) / _tileSize);
+		_tileStamps.assign(_tileGrid.area(), sequence);
+		image.copyTo(_reference(region));
+		return;
+	}
+
+	// Tiles partially covered by the region only compare (and refresh) the covered part,
+	// the rest of the tile gets compared whenever a region covering it is captured
+	const size_t pixelSize = image.elemSize();
+	const int tileMinX = region.x / _tileSize;
+	const int tileMinY = region.y / _tileSize;
+	const int tileMaxX = (region.br().x - 1) / _tileSize;
+	const int tileMaxY = (region.br().y - 1) / _tileSize;
+	for (int tileY = tileMinY; tileY <= tileMaxY; ++tileY)
+	{
+		for (int tileX = tileMinX; tileX <= tileMaxX; ++tileX)
+		{
+			cv::Rect tile = cv::Rect(tileX * _tileSize, tileY * _tileSize, _tileSize, _tileSize) & region;
+			if (tile.empty()) continue;
+
+			// Row-wise memcmp is vectorized by the C runtime and bails out on the first difference
+			const cv::Rect imageTile = tile - region.tl();
+			const size_t rowBytes = tile.width * pixelSize;
+			bool changed = false;
+			for (int y = 0; y < tile.height && !changed; ++y)
+			{
+				const uint8_t* imageRow = image.ptr<uint8_t>(imageTile.y + y) + imageTile.x * pixelSize;
+				const uint8_t* referenceRow = _reference.ptr<uint8_t>(tile.y + y) + tile.x * pixelSize;
+				changed = std::memcmp(imageRow, referenceRow, rowBytes) != 0;
+			}
+
+			if (changed)
+			{
+				_tileStamps[tileY * _tileGrid.width + tileX] = sequence;
+				image(imageTile).copyTo(_reference(tile));
+			}
+		}
+	}
+}
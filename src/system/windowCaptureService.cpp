@@ -1,145 +1,249 @@
 #include <system/windowCaptureService.h>
 
-// Windows dependencies
-#include <wingdi.h>
-#include <GdiPlus.h>
-#include <winuser.h>
-#pragma comment(lib, "gdiplus.lib")
-#pragma comment(lib, "ws2_32.lib")
+// Std dependencies
+#include <iostream>
+#include <vector>
 
-static ULONG_PTR s_gdiplusToken;
-
-WindowCaptureService::WindowCaptureService() : _capturing(false), _srcHdc(nullptr)
+WindowCaptureService::WindowCaptureService() : _capturing(false), _source(nullptr)
 {
-	// Initialize GDI+
-	Gdiplus::GdiplusStartupInput gdiplusStartupInput;
-    GdiplusStartup(&s_gdiplusToken, &gdiplusStartupInput, NULL);
-
-	_frontFrame = new cv::Mat();
-	_backFrame = new cv::Mat();
+	// Start with an empty frame so readers never get a null handle
+	_latestFrame = std::make_shared<const Frame>();
 }
 
 WindowCaptureService::~WindowCaptureService()
 {
     StopCapture();
+}
 
-	delete _frontFrame;
-	delete _backFrame;
+void WindowCaptureService::StartCapture(IFrameSource* source)
+{
+	// The new source replaces the current one (which is deleted)
+	StopCapture();
 
-	// Shutdown GDI+
-	Gdiplus::GdiplusShutdown(s_gdiplusToken);
-}
+    // Compute capture min and max points
+	cv::Rect captureRect = source->GetCaptureRect();
+    _captureMin = captureRect.tl();
+    _captureMax = captureRect.br();
 
+    _source = source;
+	_source->SetPixelFormat(_pixelFormat);
+    _capturing = true;
+    _captureThread = std::thread(&WindowCaptureService::captureLoop, this);
+}
 
-void WindowCaptureService::StartCapture(HDC srcHdc, const char* adapterName)
+void WindowCaptureService::StopCapture()
 {
-    if (_capturing) return;
+	// The thread is also joined when it already gave up (the source failed to open)
+    _capturing = false;
+	if (_captureThread.joinable()) _captureThread.join();
 
-	// Copy adapter name to monitor info
-    MONITORINFOEX monitorInfo;
-	monitorInfo.cbSize = sizeof(MONITORINFOEX);
-	strcpy_s(monitorInfo.szDevice, adapterName);
+	delete _source;
+	_source = nullptr;
+}
 
-	// Fetch size from adapter name
-	EnumDisplayMonitors(NULL, NULL, [](HMONITOR monitor, HDC, LPRECT, LPARAM lparam) -> BOOL
-	{
-		MONITORINFOEX* paramInfo = (MONITORINFOEX*)lparam;
+bool WindowCaptureService::IsCapturing() const
+{
+    return _capturing;
+}
 
-		MONITORINFOEX monitorInfo;
-		monitorInfo.cbSize = sizeof(MONITORINFOEX);
-		GetMonitorInfo(monitor, &monitorInfo);
+FrameHandle WindowCaptureService::GetLatestFrame()
+{
+    std::lock_guard<std::mutex> lock(_frameMutex);
+    return _latestFrame;
+}
 
-		if (strcmp(monitorInfo.szDevice, paramInfo->szDevice) == 0)
-		{
-			*paramInfo = monitorInfo;
-			return FALSE;
-		}
+FrameHandle WindowCaptureService::WaitForFrameNewerThan(uint64_t sequence, std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> lock(_frameMutex);
+	_frameCondition.wait_for(lock, timeout, [this, sequence]() { return _latestFrame->sequence > sequence; });
+	return _latestFrame;
+}
 
-		return TRUE;
-	}, (LPARAM)&monitorInfo);
+int WindowCaptureService::SubscribeRegion(const cv::Rect& region, uint32_t rate)
+{
+	std::lock_guard<std::mutex> lock(_frameMutex);
+	int subscriptionId = _nextSubscriptionId++;
+	_subscriptions[subscriptionId] = { region, rate, std::chrono::steady_clock::now(), nullptr };
+	return subscriptionId;
+}
 
-    // Compute capture min and max points
-    _captureMin = cv::Point(monitorInfo.rcMonitor.left, monitorInfo.rcMonitor.top);
-    _captureMax = cv::Point(monitorInfo.rcMonitor.right, monitorInfo.rcMonitor.bottom);
+void WindowCaptureService::UpdateRegion(int subscriptionId, const cv::Rect& region)
+{
+	std::lock_guard<std::mutex> lock(_frameMutex);
+	auto it = _subscriptions.find(subscriptionId);
+	if (it == _subscriptions.end() || it->second.region == region) return;
 
-    _srcHdc = srcHdc;
-    _capturing = true;
-    _captureThread = std::thread(&WindowCaptureService::captureLoop, this, srcHdc);
+	// Capture the new region right away
+	it->second.region = region;
+	it->second.nextCaptureTime = std::chrono::steady_clock::now();
 }
 
-void WindowCaptureService::StopCapture()
+void WindowCaptureService::UnsubscribeRegion(int subscriptionId)
 {
-    if (!_capturing) return;
+	std::lock_guard<std::mutex> lock(_frameMutex);
+	_subscriptions.erase(subscriptionId);
+}
 
-    _capturing = false;
-	_captureThread.join();
+FrameHandle WindowCaptureService::GetLatestRegionFrame(int subscriptionId)
+{
+	std::lock_guard<std::mutex> lock(_frameMutex);
+	auto it = _subscriptions.find(subscriptionId);
+	return it != _subscriptions.end() ? it->second.latestFrame : nullptr;
 }
 
-bool WindowCaptureService::IsCapturing() const
+int WindowCaptureService::AddFrameListener(FrameListener listener)
 {
-    return _capturing;
+	std::lock_guard<std::mutex> lock(_listenerMutex);
+	int listenerId = _nextListenerId++;
+	_listeners[listenerId] = std::move(listener);
+	return listenerId;
 }
 
-cv::Mat WindowCaptureService::GetLatestFrame()
+void WindowCaptureService::RemoveFrameListener(int listenerId)
 {
-    std::lock_guard<std::mutex> lock(_frameMutex);
-    return _frontFrame->clone();
+	// Once this returns the listener is guaranteed to not be running
+	std::lock_guard<std::mutex> lock(_listenerMutex);
+	_listeners.erase(listenerId);
 }
 
-void WindowCaptureService::captureLoop(HDC srcHdc)
+void WindowCaptureService::captureLoop()
 {
+	// Sources are opened on the capture thread, as some APIs bind resources to it
+	if (!_source->Open())
+	{
+		std::cout << "Failed to open '" << _source->GetName() << "' frame source!" << std::endl;
+		_capturing = false;
+		return;
+	}
+
+	const cv::Rect fullRegion(cv::Point(0, 0), _captureMax - _captureMin);
+	auto ratePeriod = [](uint32_t rate) { return std::chrono::microseconds(rate > 0 ? 1000000 / rate : 0); };
+
+	std::vector<FrameHandle> releasedHandles;
+	size_t capturedBytes = 0;
+	auto bytesWindowStart = std::chrono::steady_clock::now();
+	auto nextCaptureTime = std::chrono::steady_clock::now();
+	int failedCaptures = 0;
     while (_capturing)
     {
-        captureScreen(srcHdc, _backFrame);
+		// Pace the loop instead of spinning when a capture rate is set
+		uint32_t captureRate = _captureRate;
+		if (captureRate > 0)
+		{
+			std::this_thread::sleep_until(nextCaptureTime);
+			nextCaptureTime = std::max(nextCaptureTime + ratePeriod(captureRate), std::chrono::steady_clock::now());
+		}
 
+		// Full frames are captured every tick unless regions are subscribed and the full frame rate is limited
+		auto now = std::chrono::steady_clock::now();
+		cv::Rect captureRegion;
+		bool isFullFrame;
+		{
+			std::lock_guard<std::mutex> lock(_frameMutex);
+			isFullFrame = _subscriptions.empty() || _fullFrameRate == 0 || now >= _nextFullFrameTime;
+			if (isFullFrame)
+			{
+				captureRegion = fullRegion;
+			}
+			else
+			{
+				for (const auto& [id, subscription] : _subscriptions)
+				{
+					if (now < subscription.nextCaptureTime) continue;
+					captureRegion = captureRegion.empty() ? subscription.region : (captureRegion | subscription.region);
+				}
+				captureRegion &= fullRegion;
+			}
+		}
+
+		// Nothing is due this tick
+		if (captureRegion.empty())
+		{
+			if (captureRate == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		// Pooled frames keep their buffers, so this only allocates when the size changes
+		// (region frames have a pool of their own, they would keep resizing the full frame buffers otherwise)
+		FramePool& framePool = isFullFrame ? _framePool : _regionFramePool;
+		Frame* frame = framePool.Acquire();
+		frame->captureTime = now;
+		frame->region = captureRegion;
+
+		// Views into source memory are read-only, never capture into them
+		if (frame->imageOwner != nullptr)
+		{
+			frame->image.release();
+			frame->imageOwner.reset();
+		}
+		if (!_source->Capture(frame->image, captureRegion))
+		{
+			framePool.Recycle(frame);
+
+			// Back off while the source keeps failing right away (e.g. a finished replay), sources
+			// that wait for their next frame before failing (stepped replays) don't need to
+			if (std::chrono::steady_clock::now() - now < std::chrono::milliseconds(1))
+			{
+				failedCaptures = std::min(failedCaptures + 1, 6);
+				std::this_thread::sleep_for(std::chrono::milliseconds(1 << failedCaptures));
+			}
+			continue;
+		}
+		failedCaptures = 0;
+		frame->imageOwner = _source->GetFrameOwner();
+
+		// Find out which tiles changed since they were last captured
+		const uint64_t sequence = _frameSequence + 1;
+		_changeTracker.Update(frame->image, captureRegion, fullRegion.size(), sequence);
+		frame->tileSize = _changeTracker.GetTileSize();
+		frame->tileGrid = _changeTracker.GetTileGrid();
+		frame->tileStamps = _changeTracker.GetTileStamps();
+
+		// Keep track of how much data we are moving around
+		capturedBytes += frame->image.total() * frame->image.elemSize();
+		if (now - bytesWindowStart >= std::chrono::seconds(1))
+		{
+			_capturedBytesPerSecond = capturedBytes * 1000000 / std::chrono::duration_cast<std::chrono::microseconds>(now - bytesWindowStart).count();
+			capturedBytes = 0;
+			bytesWindowStart = now;
+		}
+
+		// Swap the published frames, the previous ones are released outside the lock
+		FrameHandle publishedFrame;
+		FrameHandle handle;
         {
             std::lock_guard<std::mutex> lock(_frameMutex);
-            std::swap(_frontFrame, _backFrame);
+			frame->sequence = _frameSequence = sequence;
+			frame->publishTime = std::chrono::steady_clock::now();
+			publishedFrame = framePool.Publish(frame);
+			handle = publishedFrame;
+
+			// Hand the frame to every subscription it covers
+			for (auto& [id, subscription] : _subscriptions)
+			{
+				if (!frame->Covers(subscription.region)) continue;
+				releasedHandles.push_back(std::move(subscription.latestFrame));
+				subscription.latestFrame = handle;
+				subscription.nextCaptureTime = now + ratePeriod(subscription.rate);
+			}
+
+			if (isFullFrame)
+			{
+				_nextFullFrameTime = now + ratePeriod(_fullFrameRate);
+				std::swap(_latestFrame, handle);
+			}
         }
-    }
-}
-
-void WindowCaptureService::captureScreen(HDC srcHdc, cv::Mat* outMat)
-{
-    int height = GetDeviceCaps(srcHdc, VERTRES);
-    int width = GetDeviceCaps(srcHdc, HORZRES);
-
-    HDC memHdc = CreateCompatibleDC(srcHdc);
-    HBITMAP memBit = CreateCompatibleBitmap(srcHdc, width, height);
-    HBITMAP hOldBitmap = (HBITMAP)SelectObject(memHdc, memBit);
-
-    BitBlt(memHdc, 0, 0, width, height, srcHdc, 0, 0, SRCCOPY);
-
-    BITMAPINFOHEADER bi;
-    bi.biSize = sizeof(BITMAPINFOHEADER);
-    bi.biWidth = width;
-    bi.biHeight = -height; // Negative height to indicate top-down bitmap
-    bi.biPlanes = 1;
-    bi.biBitCount = 24; // 24-bit bitmap (8 bits per channel)
-    bi.biCompression = BI_RGB;
-    bi.biSizeImage = 0;
-    bi.biXPelsPerMeter = 0;
-    bi.biYPelsPerMeter = 0;
-    bi.biClrUsed = 0;
-    bi.biClrImportant = 0;
-
-    static std::vector<BYTE> buffer(width * height * 3); // Buffer to hold bitmap data
-    GetDIBits(memHdc, memBit, 0, height, buffer.data(), (BITMAPINFO*)&bi, DIB_RGB_COLORS);
-
-	// Initialize mat if size does not match
-	if (outMat->empty() || outMat->cols != width || outMat->rows != height)
-	{
-		*outMat = cv::Mat(height, width, CV_8UC3);
-	}
+		if (isFullFrame) _frameCondition.notify_all();
+		releasedHandles.clear();
 
-	// Copy buffer data to cv::Mat using memcpy
-	for (int y = 0; y < height; ++y) {
-		BYTE* srcRow = buffer.data() + y * width * 3;
-		cv::Vec3b* dstRow = outMat->ptr<cv::Vec3b>(y);
-		memcpy(dstRow, srcRow, width * 3);
-	}
+		{
+			std::lock_guard<std::mutex> lock(_listenerMutex);
+			for (const auto& [id, listener] : _listeners)
+			{
+				listener(publishedFrame);
+			}
+		}
+    }
 
-    SelectObject(memHdc, hOldBitmap);
-    DeleteObject(memHdc);
-    DeleteObject(memBit);
-}
\ No newline at end of file
+	_source->Close();
+}
@@ -0,0 +1,1721 @@
+// Headless benchmark that replays a recorded session through the bot's task chain
+// (FindTabTask -> InventoryDropTask) and reports throughput and latency percentiles.
+//
+// Usage: replay-runner <session.osrsrec> [--stepped|--fast|--realtime] [--format bgr|bgra] [--letterbox] [--no-gating] [--no-tracking] [--tiled] [--cpu] [--tab-model <path>] [--inventory-model <path>]
+//   --stepped   every recorded frame goes through the tasks (default, deterministic)
+//   --fast      frames are replayed as fast as possible, the ones the bot can't keep up with are skipped
+//   --realtime  frames are replayed at the pace they were recorded
+//   --format    pixel format of the captured frames (run once with each to compare their cost)
+//   --letterbox preprocessing benchmark keeps the aspect ratio (padding the borders)
+//   --no-gating every task runs on every frame, even when its inputs didn't change (see TaskScheduler)
+//   --no-tracking the tab model runs whenever the tabs change, instead of verifying them against templates in between
+//   --tiled     the tab model runs over native resolution tiles of the frame (see TiledDetector)
+//   --cpu       the models run on the CPU execution provider (with the profiles tuned by --tune), instead of CUDA
+//
+// Usage: replay-runner --capture <x11[:display]|image|image folder|session.osrsrec> [--seconds <count>] [--rate <Hz>]
+//                       [--roi <x,y,w,h> ...] [--full-rate <Hz>]
+//   Runs the capture service on the given frame source (e.g. x11::99 against an Xvfb display) and reports
+//   the frames and bytes captured per second (at the bot's 60 Hz by default, 0 captures as fast as possible). Given regions of interest, runs again with them subscribed
+//   (full frames limited to the full frame rate, 1 Hz by default) and compares the bytes captured
+//
+// Usage: replay-runner --bitmap-copy [--iterations <count>]
+//   Captures through the portable bitmap layer (BitmapFrameSource) from a fake bitmap provider, checking the pixels
+//   for 24 and 32 bit bitmaps, padded strides, full frames and regions into both pixel formats, and timing each copy at 4K
+//
+// Usage: replay-runner --frame-pool [--frames <count>]
+//   Captures synthetic 4K frames and reads them the way the UI windows do (latest frame every tick, plus the bot manager's
+//   scratch copy to draw on), failing when a read copies the frame or allocates once the pool is warm
+//
+// Usage: replay-runner --models [model folder] [--cpu] [--iterations <count>]
+//   Compares the startup and steady state latency of every model in the folder (default models/) when loaded
+//   unoptimized, optimized from scratch (cold, writes the cache) and from the optimized model cache (warm),
+//   and for models exported with a dynamic batch, a batched run over several ROIs against one run per ROI.
+//   Heap allocations of the inference calls are counted after warm-up, on the CPU any of them fails the run
+//
+// Usage: replay-runner --decoders [model folder] [--image <screenshot>] [--cpu] [--iterations <count>]
+//   Records the outputs of every model in the folder on the screenshot (or a synthetic frame), then compares
+//   the decoders against their reference implementation on them (time, heap allocations and boxes), the YOLOv8 decoders
+//   specialized on the head's class count against the generic ones (both output layouts), and the
+//   detection post processing strategies against the tasks' former merge loop on the low threshold YOLOv8 boxes
+//
+// Usage: replay-runner --tiles <screenshot> [model folder] [--reference <model>] [--tile-size <pixels>] [--overlap <fraction>] [--cpu] [--iterations <count>]
+//   Runs every model in the folder on the full screenshot downscaled to its input, then tiled at native resolution
+//   (all tiles, and only the tiles of a changed corner), reporting latency, tiles run and detections. Given a reference
+//   model (e.g. the large variant run the usual downscaled way), also reports how many of its detections each run finds
+//
+// Usage: replay-runner --tune <session.osrsrec> [model folder] [--frames <count>] [--iterations <count>]
+//   Sweeps the CPU execution settings (threads, affinity, spinning, execution mode, memory pattern and arena) of every
+//   model in the folder over frames of the recording, and stores the fastest profile per model for this machine
+//   (execution_profiles.json), which later loads of the model pick up
+//
+// Usage: replay-runner --calibrate <model> <session.osrsrec|screenshot folder> [output folder] [--frames <count>]
+//   Writes the model's input tensors for frames of the recording (or the bot's screenshots) as .npy files,
+//   the calibration data scripts/quantize.py uses for static INT8 quantization
+//
+// Usage: replay-runner --evaluate <labeled screenshot folder> <model> [<model> ...] [--cpu]
+//   Reports mAP50, mAP50-95 and latency of every model on the screenshots exported by the bot (with their labels),
+//   the following models against the first one (e.g. the INT8 variants against the FP32 model)
+
+// Std dependencies
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Third party dependencies
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+// Internal dependencies
+#include <system/windowCaptureService.h>
+#include <system/resourceManager.h>
+#include <system/frameSources/mappedReplayFrameSource.h>
+#include <system/frameSources/replayFrameSource.h>
+#include <system/frameSources/bitmapFrameSource.h>
+#ifndef _WIN32
+#include <system/frameSources/x11FrameSource.h>
+#endif
+#include <ml/boxDecoders.h>
+#include <ml/detectionPostProcess.h>
+#include <ml/executionProfile.h>
+#include <ml/imageToTensor.h>
+#include <ml/onnxruntimeInference.h>
+#include <ml/tiledInference.h>
+#include <bot/taskScheduler.h>
+#include <bot/tasks/findTabTask.h>
+#include <bot/tasks/inventoryDropTask.h>
+
+// Every heap allocation made through operator new (including the ones made by the libraries) is counted,
+// so the steady state allocations of the task chain can be tracked (the per thread count leaves out the capture thread)
+static std::atomic<uint64_t> allocationCount = 0;
+static thread_local uint64_t threadAllocationCount = 0;
+
+void* operator new(size_t size)
+{
+	++allocationCount;
+	++threadAllocationCount;
+	if (void* memory = std::malloc(size > 0 ? size : 1)) return memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+static double percentile(std::vector<double>& values, double p)
+{
+	if (values.empty()) return 0.0;
+	const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+static void printPercentiles(const char* label, std::vector<double>& values)
+{
+	printf("%-28s p50 %8.3f ms | p90 %8.3f ms | p99 %8.3f ms | max %8.3f ms\n", label, percentile(values, 0.5), percentile(values, 0.9),
+		   percentile(values, 0.99), percentile(values, 1.0));
+}
+
+static double toMilliseconds(std::chrono::steady_clock::duration duration)
+{
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Same model types the tasks use, picked by file name
+static PreProcessBoxDetectionBase* createModel(const std::filesystem::path& modelPath)
+{
+	if (modelPath.filename().string().find("rf-detr") != std::string::npos) return new RF_DETR(8, 0.5f);
+	return new YOLOv8(8, 0.5f);
+}
+
+// YOLOv8 heads have the class count baked into the output shape
+static void fitClassNumber(PreProcessBoxDetectionBase* model)
+{
+	if (dynamic_cast<YOLOv8*>(model) == nullptr || model->GetOutputCount() == 0) return;
+
+	const std::vector<int64_t>& outputShape = model->GetOutputShape(0);
+	if (outputShape.size() == 3 && outputShape[1] > 4) model->SetClassNumber((int)outputShape[1] - 4);
+}
+
+// Noise at the model input size
+static cv::Mat createSyntheticFrame(PreProcessBoxDetectionBase* model)
+{
+	const std::vector<int64_t>& inputShape = model->GetInputShape();
+	const int width = inputShape.size() == 4 && inputShape[3] > 0 ? (int)inputShape[3] : 640;
+	const int height = inputShape.size() == 4 && inputShape[2] > 0 ? (int)inputShape[2] : 640;
+	cv::Mat frame(height, width, CV_8UC3);
+	cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+	return frame;
+}
+
+// Loads the model and, when iterations are given, measures its steady state inference latency on a synthetic frame
+// (along with the heap allocations of the inference calls alone, warm-up excluded)
+static bool benchmarkModel(PreProcessBoxDetectionBase* model, const std::filesystem::path& modelPath, bool useCuda, int iterations,
+						   std::vector<double>& latencies, uint64_t& allocations)
+{
+	allocations = 0;
+	if (!model->LoadModel(useCuda, modelPath.wstring().c_str())) return false;
+	if (iterations <= 0) return true;
+
+	fitClassNumber(model);
+	cv::Mat frame = createSyntheticFrame(model);
+
+	std::vector<DetectionBox> boxes;
+	const int warmUpIterations = std::max(1, iterations / 10);
+	for (int i = 0; i < warmUpIterations; ++i)
+	{
+		model->Inference(frame, boxes);
+	}
+
+	latencies.clear();
+	latencies.reserve(iterations);
+	for (int i = 0; i < iterations; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const uint64_t allocationsBefore = allocationCount;
+		model->Inference(frame, boxes);
+		allocations += allocationCount - allocationsBefore;
+		latencies.push_back(toMilliseconds(std::chrono::steady_clock::now() - start));
+	}
+	return true;
+}
+
+// Frames made up on the spot, a bright band moves down the screen so every frame differs
+class SyntheticFrameSource : public IFrameSource
+{
+public:
+	SyntheticFrameSource(const cv::Size& size) : _size(size) {}
+
+	virtual bool Open() override { return true; }
+	virtual void Close() override {}
+
+	virtual bool Capture(cv::Mat& outFrame, const cv::Rect& region) override
+	{
+		outFrame.create(region.size(), _pixelFormat == FRAME_FORMAT_BGRA ? CV_8UC4 : CV_8UC3);
+		outFrame.setTo(cv::Scalar::all(32));
+		const cv::Rect band = cv::Rect(0, (int)(_frameIndex++ * 8 % _size.height), _size.width, 64) & region;
+		if (!band.empty()) outFrame(band - region.tl()).setTo(cv::Scalar::all(224));
+		return true;
+	}
+
+	virtual cv::Rect GetCaptureRect() const override { return cv::Rect(cv::Point(0, 0), _size); }
+	virtual const char* GetName() override { return "Synthetic"; }
+
+private:
+	cv::Size _size;
+	uint64_t _frameIndex = 0;
+};
+
+static int checkFramePool(int frameCount)
+{
+	WindowCaptureService& captureService = WindowCaptureService::GetInstance();
+	captureService.SetCaptureRate(0);
+	captureService.StartCapture(new SyntheticFrameSource(cv::Size(3840, 2160)));
+
+	// Three readers per tick (the bot manager, training lab and task workshop windows), the first one draws on a copy
+	cv::Mat drawFrame;
+	size_t copiedReads = 0;
+	FrameHandle frameHandle = captureService.GetLatestFrame();
+	auto readFrame = [&]()
+	{
+		frameHandle = captureService.WaitForFrameNewerThan(frameHandle->sequence, std::chrono::seconds(1));
+		for (int reader = 0; reader < 3; ++reader)
+		{
+			FrameHandle readerHandle = captureService.GetLatestFrame();
+			if (readerHandle->image.data != frameHandle->image.data && readerHandle->sequence == frameHandle->sequence) ++copiedReads;
+			if (reader == 0 && !readerHandle->image.empty()) readerHandle->image.copyTo(drawFrame);
+		}
+	};
+
+	// Warm up the pool and the scratch frame
+	for (int i = 0; i < 10; ++i)
+	{
+		readFrame();
+	}
+
+	copiedReads = 0;
+	const uint64_t readerAllocationsBefore = threadAllocationCount;
+	const uint64_t allocationsBefore = allocationCount;
+	const uint64_t firstSequence = frameHandle->sequence;
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < frameCount; ++i)
+	{
+		readFrame();
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const uint64_t readerAllocations = threadAllocationCount - readerAllocationsBefore;
+	const uint64_t allocations = allocationCount - allocationsBefore;
+	const uint64_t capturedFrames = frameHandle->sequence - firstSequence;
+	frameHandle = nullptr;
+	captureService.StopCapture();
+
+	printf("Read %d frames (%llu captured) in %.3f s\n", frameCount, static_cast<unsigned long long>(capturedFrames), seconds);
+	printf("Reads that copied the frame: %zu\n", copiedReads);
+	printf("Heap allocations: %llu on the reading thread, %.2f per captured frame overall (frame handles)\n",
+		   static_cast<unsigned long long>(readerAllocations), capturedFrames > 0 ? (double)allocations / capturedFrames : 0.0);
+	if (copiedReads > 0 || readerAllocations > 0)
+	{
+		printf("FAILED: reading frames copies or allocates\n");
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
+
+// Bitmap in plain memory, standing in for a GDI DIB section or an X11 shared image
+class FakeBitmapProvider : public IBitmapProvider
+{
+public:
+	FakeBitmapProvider(const cv::Size& size, int bitsPerPixel, size_t rowPadding) : _size(size), _bitsPerPixel(bitsPerPixel), _rowPadding(rowPadding) {}
+
+	virtual cv::Size GetSourceSize() override { return _size; }
+
+	virtual bool Allocate(const cv::Size& size, FramePixelFormat format) override
+	{
+		++_allocationCount;
+		_pixels.width = size.width;
+		_pixels.height = size.height;
+		_pixels.bitsPerPixel = _bitsPerPixel;
+		_pixels.stride = size.width * (_bitsPerPixel / 8) + _rowPadding;
+		_memory.assign(_pixels.stride * size.height, 0);
+		_pixels.data = _memory.data();
+		return true;
+	}
+
+	virtual void Release() override
+	{
+		_memory.clear();
+		_pixels = PixelBuffer();
+	}
+
+	// Every byte tells where it is, so copies can be checked anywhere
+	virtual bool Grab(const cv::Rect& region) override
+	{
+		const int pixelSize = _bitsPerPixel / 8;
+		for (int y = region.y; y < region.br().y; ++y)
+		{
+			uint8_t* row = _pixels.data + y * _pixels.stride;
+			for (int x = region.x; x < region.br().x; ++x)
+			{
+				for (int channel = 0; channel < pixelSize; ++channel)
+				{
+					row[x * pixelSize + channel] = Expected(x, y, channel);
+				}
+			}
+		}
+		return true;
+	}
+
+	virtual PixelBuffer GetPixels() const override { return _pixels; }
+
+	static uint8_t Expected(int x, int y, int channel) { return (uint8_t)(x * 3 + y * 7 + channel * 11); }
+	int GetAllocationCount() const { return _allocationCount; }
+
+private:
+	cv::Size _size;
+	int _bitsPerPixel;
+	size_t _rowPadding;
+	std::vector<uint8_t> _memory;
+	PixelBuffer _pixels;
+	int _allocationCount = 0;
+};
+
+// Whether the frame holds the region of the fake bitmap (alpha is opaque when the bitmap has none)
+static bool checkBitmapCopy(const cv::Mat& frame, const cv::Rect& region, int bitsPerPixel, FramePixelFormat format)
+{
+	const int channels = format == FRAME_FORMAT_BGRA ? 4 : 3;
+	if (frame.cols != region.width || frame.rows != region.height || frame.channels() != channels) return false;
+
+	for (int y = 0; y < frame.rows; ++y)
+	{
+		const uint8_t* row = frame.ptr<uint8_t>(y);
+		for (int x = 0; x < frame.cols; ++x)
+		{
+			for (int channel = 0; channel < channels; ++channel)
+			{
+				const uint8_t expected = channel == 3 && bitsPerPixel == 24 ? 255 : FakeBitmapProvider::Expected(region.x + x, region.y + y, channel);
+				if (row[x * channels + channel] != expected) return false;
+			}
+		}
+	}
+	return true;
+}
+
+static int benchmarkBitmapCopy(int iterations)
+{
+	const cv::Size sourceSize(3840, 2160);
+	const cv::Rect regions[] = { cv::Rect(cv::Point(0, 0), sourceSize), cv::Rect(3021, 1405, 241, 333) };
+	const char* regionNames[] = { "full", "region" };
+
+	bool allMatching = true;
+	for (int bitsPerPixel : { 24, 32 })
+	{
+		// Tightly packed rows, and rows padded the way DIB sections align them
+		for (size_t rowPadding : { (size_t)0, (size_t)4 })
+		{
+			for (FramePixelFormat format : { FRAME_FORMAT_BGR, FRAME_FORMAT_BGRA })
+			{
+				for (int r = 0; r < 2; ++r)
+				{
+					FakeBitmapProvider* provider = new FakeBitmapProvider(sourceSize, bitsPerPixel, rowPadding);
+					BitmapFrameSource source(provider, cv::Rect(cv::Point(0, 0), sourceSize));
+					source.SetPixelFormat(format);
+					source.Open();
+
+					cv::Mat frame;
+					bool matching = source.Capture(frame, regions[r]) && checkBitmapCopy(frame, regions[r], bitsPerPixel, format);
+
+					// Later captures reuse the bitmap and the frame memory
+					const uint8_t* frameData = frame.data;
+					source.Capture(frame, regions[r]);
+					const bool reused = provider->GetAllocationCount() == 1 && frame.data == frameData;
+
+					// Only the copy out of the bitmap is timed (the fake grab is a plain loop)
+					std::vector<double> times;
+					for (int i = 0; i < iterations; ++i)
+					{
+						const auto start = std::chrono::steady_clock::now();
+						CopyPixels(provider->GetPixels(), regions[r], frame, format);
+						times.push_back(toMilliseconds(std::chrono::steady_clock::now() - start));
+					}
+					source.Close();
+
+					allMatching &= matching && reused;
+					printf("%2d bpp, %s stride -> %s, %-6s: %s%s, copy p50 %8.3f ms\n", bitsPerPixel, rowPadding > 0 ? "padded" : "packed",
+						   format == FRAME_FORMAT_BGRA ? "BGRA" : "BGR ", regionNames[r], matching ? "pixels match" : "PIXELS DIFFER",
+						   reused ? "" : ", REALLOCATED", percentile(times, 0.5));
+				}
+			}
+		}
+	}
+
+	if (!allMatching)
+	{
+		printf("FAILED: bitmap copies don't match the source\n");
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
+
+// X11 screens by name (off Windows), recorded sessions and screenshots by path
+static IFrameSource* createFrameSource(const std::string& sourceName)
+{
+#ifndef _WIN32
+	if (sourceName == "x11") return new X11FrameSource();
+	if (sourceName.rfind("x11:", 0) == 0) return new X11FrameSource(sourceName.substr(4));
+#endif
+	const std::filesystem::path path = sourceName;
+	if (path.extension() == ".osrsrec") return new MappedReplayFrameSource(path, REPLAY_AS_FAST_AS_POSSIBLE, true);
+	return new ReplayFrameSource(path);
+}
+
+// Captures from the source for a while, with the regions subscribed (if any), returning the bytes captured per second
+static bool runCapture(const std::string& sourceName, double seconds, uint32_t rate, const std::vector<cv::Rect>& regions, uint32_t fullFrameRate,
+					   double& bytesPerSecond)
+{
+	IFrameSource* source = createFrameSource(sourceName);
+	const cv::Rect captureRect = source->GetCaptureRect();
+	const std::string name = source->GetName();
+	if (captureRect.empty())
+	{
+		printf("'%s' has nothing to capture\n", sourceName.c_str());
+		delete source;
+		return false;
+	}
+
+	// Every published frame counts, full or region
+	std::atomic<uint64_t> capturedFrames = 0;
+	std::atomic<uint64_t> capturedBytes = 0;
+	WindowCaptureService& captureService = WindowCaptureService::GetInstance();
+	const int listenerId = captureService.AddFrameListener([&](const FrameHandle& frame)
+	{
+		++capturedFrames;
+		capturedBytes += frame->image.total() * frame->image.elemSize();
+	});
+	std::vector<int> subscriptions;
+	for (const cv::Rect& region : regions)
+	{
+		subscriptions.push_back(captureService.SubscribeRegion(region));
+	}
+	captureService.SetCaptureRate(rate);
+	captureService.SetFullFrameRate(regions.empty() ? 0 : fullFrameRate);
+	captureService.StartCapture(source);
+
+	auto stopCapture = [&]()
+	{
+		captureService.RemoveFrameListener(listenerId);
+		captureService.StopCapture();
+		for (int subscription : subscriptions)
+		{
+			captureService.UnsubscribeRegion(subscription);
+		}
+	};
+
+	FrameHandle frameHandle = captureService.WaitForFrameNewerThan(0, std::chrono::seconds(5));
+	if (frameHandle->sequence == 0)
+	{
+		printf("'%s' didn't produce any frame\n", name.c_str());
+		stopCapture();
+		return false;
+	}
+
+	const cv::Size frameSize = frameHandle->image.size();
+	const int frameChannels = frameHandle->image.channels();
+	const cv::Scalar frameMean = cv::mean(frameHandle->image);
+	capturedFrames = 0;
+	capturedBytes = 0;
+	const auto start = std::chrono::steady_clock::now();
+	while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < seconds && captureService.IsCapturing())
+	{
+		frameHandle = captureService.WaitForFrameNewerThan(frameHandle->sequence, std::chrono::seconds(1));
+	}
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	frameHandle = nullptr;
+	stopCapture();
+
+	bytesPerSecond = capturedBytes / std::max(elapsed, 1e-9);
+	if (!regions.empty()) printf("With %zu regions subscribed, full frames at %u Hz\n", regions.size(), fullFrameRate);
+	printf("%s: %dx%d frames (%d channels, mean %.1f), capture area %dx%d at (%d, %d)\n", name.c_str(), frameSize.width, frameSize.height, frameChannels,
+		   (frameMean[0] + frameMean[1] + frameMean[2]) / 3.0, captureRect.width, captureRect.height, captureRect.x, captureRect.y);
+	printf("Captured %llu frames in %.3f s: %.2f frames/s, %.2f MB/s\n", static_cast<unsigned long long>(capturedFrames.load()), elapsed,
+		   capturedFrames / std::max(elapsed, 1e-9), bytesPerSecond / (1024.0 * 1024.0));
+	return true;
+}
+
+static int benchmarkCapture(const std::string& sourceName, double seconds, uint32_t rate, const std::vector<cv::Rect>& regions, uint32_t fullFrameRate)
+{
+	double fullBytesPerSecond = 0.0;
+	if (!runCapture(sourceName, seconds, rate, {}, 0, fullBytesPerSecond)) return 1;
+	if (regions.empty()) return 0;
+
+	double regionBytesPerSecond = 0.0;
+	if (!runCapture(sourceName, seconds, rate, regions, fullFrameRate, regionBytesPerSecond)) return 1;
+	printf("Regions of interest capture %.1f%% of the bytes (%.2f MB/s instead of %.2f MB/s)\n", 100.0 * regionBytesPerSecond / std::max(fullBytesPerSecond, 1e-9),
+		   regionBytesPerSecond / (1024.0 * 1024.0), fullBytesPerSecond / (1024.0 * 1024.0));
+	return 0;
+}
+
+// ROIs per batch in the batching benchmark
+static const int batchBenchmarkSize = 4;
+
+static std::string fmtLabel(const char* format, int value)
+{
+	char label[64];
+	snprintf(label, sizeof(label), format, value);
+	return label;
+}
+
+static int benchmarkModels(const std::filesystem::path& modelFolder, bool useCuda, int iterations)
+{
+	std::vector<std::filesystem::path> modelPaths;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(modelFolder, error))
+	{
+		if (entry.path().extension() == ".onnx") modelPaths.push_back(entry.path());
+	}
+	std::sort(modelPaths.begin(), modelPaths.end());
+	if (modelPaths.empty())
+	{
+		printf("No models found in '%s'\n", modelFolder.string().c_str());
+		return 1;
+	}
+
+	struct ModelResult
+	{
+		std::filesystem::path path;
+		double unoptimizedLoad, coldLoad, warmLoad;
+		std::vector<double> unoptimizedLatencies, optimizedLatencies;
+		uint64_t unoptimizedAllocations, optimizedAllocations;
+		bool batching;
+		std::vector<double> serialLatencies, batchLatencies;
+	};
+	std::vector<ModelResult> results;
+	for (const auto& modelPath : modelPaths)
+	{
+		ModelResult result = { modelPath };
+		std::vector<double> unused;
+		uint64_t unusedAllocations;
+
+		// Unoptimized, the way models used to be loaded
+		PreProcessBoxDetectionBase* model = createModel(modelPath);
+		model->SetModelCache(false);
+		bool loaded = benchmarkModel(model, modelPath, useCuda, iterations, result.unoptimizedLatencies, result.unoptimizedAllocations);
+		result.unoptimizedLoad = model->GetLoadTime();
+		delete model;
+
+		// Cold, the cache is dropped first so the graph gets optimized and serialized again
+		model = createModel(modelPath);
+		std::filesystem::remove(model->GetCachedModelPath(modelPath, useCuda), error);
+		loaded &= benchmarkModel(model, modelPath, useCuda, 0, unused, unusedAllocations);
+		result.coldLoad = model->GetLoadTime();
+		delete model;
+
+		// Warm, straight from the cache
+		model = createModel(modelPath);
+		loaded &= benchmarkModel(model, modelPath, useCuda, iterations, result.optimizedLatencies, result.optimizedAllocations);
+		result.warmLoad = model->GetLoadTime();
+		loaded &= model->IsLoadedFromCache();
+
+		// Several ROIs in one batched run against one run per ROI
+		result.batching = loaded && model->SupportsBatching();
+		if (result.batching)
+		{
+			const std::vector<cv::Mat> rois(batchBenchmarkSize, createSyntheticFrame(model));
+			std::vector<std::vector<DetectionBox>> roiBoxes(rois.size());
+			for (int i = 0; i < iterations; ++i)
+			{
+				const auto serialStart = std::chrono::steady_clock::now();
+				for (size_t roi = 0; roi < rois.size(); ++roi)
+				{
+					cv::Mat image = rois[roi];
+					model->Inference(image, roiBoxes[roi]);
+				}
+				const auto batchStart = std::chrono::steady_clock::now();
+				model->InferenceBatch(rois, roiBoxes);
+				result.serialLatencies.push_back(toMilliseconds(batchStart - serialStart));
+				result.batchLatencies.push_back(toMilliseconds(std::chrono::steady_clock::now() - batchStart));
+			}
+		}
+		delete model;
+
+		if (!loaded)
+		{
+			printf("Failed to benchmark '%s'\n", modelPath.string().c_str());
+			return 1;
+		}
+		results.push_back(std::move(result));
+	}
+
+	printf("\nModel startup (%s, %d iterations)\n", useCuda ? "CUDA" : "CPU", iterations);
+	bool allocationFree = true;
+	for (auto& result : results)
+	{
+		printf("\n%s\n", result.path.filename().string().c_str());
+		printf("%-28s unoptimized %9.1f ms | cold %9.1f ms | warm %9.1f ms\n", "Session creation:", result.unoptimizedLoad, result.coldLoad,
+			   result.warmLoad);
+		printPercentiles("Inference unoptimized:", result.unoptimizedLatencies);
+		printPercentiles("Inference optimized:", result.optimizedLatencies);
+		printf("%-28s unoptimized %9.2f | optimized %9.2f\n", "Heap allocations/inference:", (double)result.unoptimizedAllocations / iterations,
+			   (double)result.optimizedAllocations / iterations);
+		allocationFree &= result.unoptimizedAllocations == 0 && result.optimizedAllocations == 0;
+		if (result.batching)
+		{
+			printPercentiles(fmtLabel("%d ROIs serial:", batchBenchmarkSize).c_str(), result.serialLatencies);
+			printPercentiles(fmtLabel("%d ROIs batched:", batchBenchmarkSize).c_str(), result.batchLatencies);
+		}
+		else
+		{
+			printf("%-28s static batch dimension, ROIs run one at a time\n", "Batching:");
+		}
+	}
+
+	// Bound inputs and outputs are reused, so steady state CPU inference must not touch the heap
+	if (!useCuda && !allocationFree)
+	{
+		printf("\nFAILED: inference allocated on the heap after warm-up\n");
+		return 1;
+	}
+	return 0;
+}
+
+// Times a decoder over the iterations, also counting the heap allocations it makes
+template<typename TDecode>
+static void measureDecoder(int iterations, std::vector<double>& times, uint64_t& allocations, TDecode decode)
+{
+	times.clear();
+	times.reserve(iterations);
+	const uint64_t allocationsBefore = allocationCount;
+	for (int i = 0; i < iterations; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		decode();
+		times.push_back(toMilliseconds(std::chrono::steady_clock::now() - start));
+	}
+	allocations = allocationCount - allocationsBefore;
+}
+
+// Same boxes regardless of their order (ties in score can come out either way)
+static bool sameDetections(std::vector<DetectionBox> boxes, std::vector<DetectionBox> referenceBoxes)
+{
+	if (boxes.size() != referenceBoxes.size()) return false;
+
+	auto order = [](const DetectionBox& a, const DetectionBox& b)
+	{
+		return a.classId != b.classId ? a.classId < b.classId : (a.x != b.x ? a.x < b.x : (a.y != b.y ? a.y < b.y : a.w < b.w));
+	};
+	std::sort(boxes.begin(), boxes.end(), order);
+	std::sort(referenceBoxes.begin(), referenceBoxes.end(), order);
+	for (size_t i = 0; i < boxes.size(); ++i)
+	{
+		const DetectionBox& box = boxes[i];
+		const DetectionBox& referenceBox = referenceBoxes[i];
+		if (box.classId != referenceBox.classId || std::abs(box.x - referenceBox.x) > 1e-3f || std::abs(box.y - referenceBox.y) > 1e-3f ||
+			std::abs(box.w - referenceBox.w) > 1e-3f || std::abs(box.h - referenceBox.h) > 1e-3f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void printDecoderComparison(float threshold, const std::vector<DetectionBox>& boxes, const std::vector<DetectionBox>& referenceBoxes,
+								   std::vector<double>& times, std::vector<double>& referenceTimes, uint64_t allocations,
+								   uint64_t referenceAllocations, int iterations, bool& matching)
+{
+	const bool same = sameDetections(boxes, referenceBoxes);
+	matching &= same;
+
+	printf("Threshold %.2f: %zu boxes, %s\n", threshold, boxes.size(), same ? "decoders match" : "DECODERS DIFFER");
+	printPercentiles("Decode:", times);
+	printPercentiles("Decode reference:", referenceTimes);
+	printf("%-28s %.2f per frame | reference %.2f per frame\n", "Heap allocations:", (double)allocations / iterations,
+		   (double)referenceAllocations / iterations);
+}
+
+// Compares the decoder compiled for the head's class count against the generic one, for both output layouts
+static void benchmarkSpecializedDecoder(const float* output, int predictionCount, int classCount, int iterations, bool& matching)
+{
+	bool specialized = false;
+	selectYOLOv8Decoder(classCount, BOX_CXCYWH_PIXELS, LAYOUT_CHANNEL_MAJOR, &specialized);
+	printf("Specialized decoders (%d classes%s):\n", classCount, specialized ? "" : ", none compiled for this class count");
+
+	// Same outputs transposed, as a prediction major export would lay them out
+	const int featureCount = classCount + 4;
+	std::vector<float> transposed((size_t)featureCount * predictionCount);
+	for (int f = 0; f < featureCount; ++f)
+	{
+		for (int p = 0; p < predictionCount; ++p) transposed[(size_t)p * featureCount + f] = output[(size_t)f * predictionCount + p];
+	}
+
+	const cv::Size inputSize(640, 640);
+	const cv::Vec2f scale(1.0f, 1.0f), padding(0.0f, 0.0f);
+	std::vector<DetectionBox> boxes, genericBoxes;
+	std::vector<double> times, genericTimes;
+	uint64_t allocations = 0, genericAllocations = 0;
+	for (OutputLayout layout : { LAYOUT_CHANNEL_MAJOR, LAYOUT_PREDICTION_MAJOR })
+	{
+		const float* layoutOutput = layout == LAYOUT_CHANNEL_MAJOR ? output : transposed.data();
+		const YOLOv8DecodeFunction decoder = selectYOLOv8Decoder(classCount, BOX_CXCYWH_PIXELS, layout);
+		const YOLOv8DecodeFunction genericDecoder = selectYOLOv8Decoder(0, BOX_CXCYWH_PIXELS, layout);
+		for (float threshold : { 0.5f, 0.05f })
+		{
+			measureDecoder(iterations, times, allocations, [&]()
+						   { decoder(layoutOutput, predictionCount, featureCount, classCount, threshold, inputSize, scale, padding, boxes); });
+			measureDecoder(iterations, genericTimes, genericAllocations, [&]()
+						   { genericDecoder(layoutOutput, predictionCount, featureCount, classCount, threshold, inputSize, scale, padding, genericBoxes); });
+
+			const bool same = sameDetections(boxes, genericBoxes);
+			matching &= same;
+			printf("%s, threshold %.2f: %zu boxes, %s\n", OutputLayoutNames[layout], threshold, boxes.size(), same ? "decoders match" : "DECODERS DIFFER");
+			printPercentiles("Specialized:", times);
+			printPercentiles("Generic:", genericTimes);
+		}
+	}
+}
+
+// Compares the post processing strategies against the merge loop the tasks used, on the same decoded boxes
+static void benchmarkPostProcessing(const std::vector<DetectionBox>& decodedBoxes, int iterations)
+{
+	printf("Post processing %zu boxes:\n", decodedBoxes.size());
+
+	// Every run starts from a copy of the decoded boxes (made into a reused buffer, so it doesn't allocate)
+	std::vector<DetectionBox> boxes;
+	boxes.reserve(decodedBoxes.size());
+	std::vector<double> times;
+	uint64_t allocations = 0;
+	measureDecoder(iterations, times, allocations, [&]()
+				   {
+					   boxes.assign(decodedBoxes.begin(), decodedBoxes.end());
+					   mergeOverlappingReference(boxes);
+				   });
+	printf("%-28s %zu kept, %.2f heap allocations per frame\n", "Merge loop (reference):", boxes.size(), (double)allocations / iterations);
+	printPercentiles("", times);
+
+	DetectionPostProcessor postProcessor;
+	for (PostProcessMode mode : { POSTPROCESS_MERGE, POSTPROCESS_NMS, POSTPROCESS_SOFT_NMS })
+	{
+		PostProcessConfig config;
+		config.mode = mode;
+		config.overlapThreshold = mode == POSTPROCESS_MERGE ? 0.3f : 0.45f;
+		postProcessor.SetConfig(config);
+		measureDecoder(iterations, times, allocations, [&]()
+					   {
+						   boxes.assign(decodedBoxes.begin(), decodedBoxes.end());
+						   postProcessor.Process(boxes);
+					   });
+		const std::string label = std::string(PostProcessModeNames[mode]) + ":";
+		printf("%-28s %zu kept, %.2f heap allocations per frame\n", label.c_str(), boxes.size(), (double)allocations / iterations);
+		printPercentiles("", times);
+	}
+}
+
+static int benchmarkDecoders(const std::filesystem::path& modelFolder, const std::filesystem::path& imagePath, bool useCuda, int iterations)
+{
+	std::vector<std::filesystem::path> modelPaths;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(modelFolder, error))
+	{
+		if (entry.path().extension() == ".onnx") modelPaths.push_back(entry.path());
+	}
+	std::sort(modelPaths.begin(), modelPaths.end());
+	if (modelPaths.empty())
+	{
+		printf("No models found in '%s'\n", modelFolder.string().c_str());
+		return 1;
+	}
+
+	const cv::Mat image = imagePath.empty() ? cv::Mat() : cv::imread(imagePath.string());
+	if (!imagePath.empty() && image.empty())
+	{
+		printf("Couldn't read '%s'\n", imagePath.string().c_str());
+		return 1;
+	}
+
+	const float thresholds[] = { 0.5f, 0.05f };
+	const cv::Vec2f scale(1.0f, 1.0f), padding(0.0f, 0.0f);
+	bool matching = true;
+	for (const auto& modelPath : modelPaths)
+	{
+		PreProcessBoxDetectionBase* model = createModel(modelPath);
+		if (!model->LoadModel(useCuda, modelPath.wstring().c_str()))
+		{
+			printf("Failed to load '%s'\n", modelPath.string().c_str());
+			delete model;
+			return 1;
+		}
+		fitClassNumber(model);
+
+		// Record the raw outputs of a real inference
+		cv::Mat frame = image.empty() ? createSyntheticFrame(model) : image.clone();
+		std::vector<DetectionBox> boxes, referenceBoxes;
+		model->Inference(frame, boxes);
+		std::vector<std::vector<float>> outputs;
+		for (size_t i = 0; i < model->GetOutputCount(); ++i)
+		{
+			size_t elementCount = 1;
+			for (int64_t dim : model->GetOutputShape(i)) elementCount *= dim;
+			outputs.emplace_back(model->GetOutputData(i), model->GetOutputData(i) + elementCount);
+		}
+
+		std::vector<double> times, referenceTimes;
+		uint64_t allocations = 0, referenceAllocations = 0;
+		if (dynamic_cast<YOLOv8*>(model) != nullptr)
+		{
+			const int featureCount = (int)model->GetOutputShape(0)[1];
+			const int predictionCount = (int)model->GetOutputShape(0)[2];
+			const int classCount = featureCount - 4;
+			printf("\n%s (YOLOv8, %d classes, %d predictions)\n", modelPath.filename().string().c_str(), classCount, predictionCount);
+
+			cv::Mat transposedOutput;
+			for (float threshold : thresholds)
+			{
+				measureDecoder(iterations, times, allocations, [&]()
+							   { decodeYOLOv8(outputs[0].data(), predictionCount, classCount, threshold, scale, padding, boxes); });
+				measureDecoder(iterations, referenceTimes, referenceAllocations, [&]()
+							   {
+								   decodeYOLOv8Reference(outputs[0].data(), predictionCount, classCount, threshold, scale, padding, transposedOutput,
+														 referenceBoxes);
+							   });
+				printDecoderComparison(threshold, boxes, referenceBoxes, times, referenceTimes, allocations, referenceAllocations, iterations, matching);
+			}
+
+			// Class count as a template argument (the tab model has 8 classes, the inventory one 18)
+			benchmarkSpecializedDecoder(outputs[0].data(), predictionCount, classCount, iterations, matching);
+
+			// Low thresholds leave thousands of candidates, which is where the merge loop falls over
+			benchmarkPostProcessing(boxes, iterations);
+		}
+		else
+		{
+			const int queryCount = (int)model->GetOutputShape(0)[1];
+			const int classCount = (int)model->GetOutputShape(1)[2];
+			const std::vector<int64_t>& inputShape = model->GetInputShape();
+			const cv::Size inputSize((int)inputShape[3], (int)inputShape[2]);
+			printf("\n%s (RF_DETR, %d classes, %d queries)\n", modelPath.filename().string().c_str(), classCount, queryCount);
+
+			std::vector<std::pair<float, int>> candidates;
+			for (float threshold : thresholds)
+			{
+				measureDecoder(iterations, times, allocations, [&]()
+							   {
+								   decodeRFDETR(outputs[0].data(), outputs[1].data(), queryCount, classCount, threshold, 300, inputSize, scale, padding,
+												candidates, boxes);
+							   });
+				measureDecoder(iterations, referenceTimes, referenceAllocations, [&]()
+							   {
+								   decodeRFDETRReference(outputs[0].data(), outputs[1].data(), queryCount, classCount, threshold, 300, inputSize, scale,
+														 padding, referenceBoxes);
+							   });
+				printDecoderComparison(threshold, boxes, referenceBoxes, times, referenceTimes, allocations, referenceAllocations, iterations, matching);
+			}
+		}
+		delete model;
+	}
+	return matching ? 0 : 1;
+}
+
+// Frame over the whole image, every tile of the change tracking grid stamped as unchanged since the start
+static std::shared_ptr<Frame> createTrackedFrame(const cv::Mat& image, int trackingTileSize)
+{
+	std::shared_ptr<Frame> frame = std::make_shared<Frame>();
+	frame->image = image;
+	frame->region = cv::Rect(0, 0, image.cols, image.rows);
+	frame->tileSize = trackingTileSize;
+	frame->tileGrid = cv::Size((image.cols + trackingTileSize - 1) / trackingTileSize, (image.rows + trackingTileSize - 1) / trackingTileSize);
+	frame->tileStamps.assign(frame->tileGrid.area(), 0);
+	return frame;
+}
+
+// Fraction of the reference boxes matched by a box of the same class (IoU of at least a half)
+static float computeRecall(const std::vector<DetectionBox>& boxes, const std::vector<DetectionBox>& referenceBoxes)
+{
+	if (referenceBoxes.empty()) return 1.0f;
+
+	int matched = 0;
+	for (const auto& reference : referenceBoxes)
+	{
+		for (const auto& box : boxes)
+		{
+			if (box.classId != reference.classId) continue;
+			const float dx = std::min(box.x + box.w, reference.x + reference.w) - std::max(box.x, reference.x);
+			const float dy = std::min(box.y + box.h, reference.y + reference.h) - std::max(box.y, reference.y);
+			if (dx <= 0.0f || dy <= 0.0f) continue;
+			const float intersection = dx * dy;
+			if (intersection / (box.w * box.h + reference.w * reference.h - intersection) >= 0.5f)
+			{
+				++matched;
+				break;
+			}
+		}
+	}
+	return (float)matched / referenceBoxes.size();
+}
+
+static int benchmarkTiling(const std::filesystem::path& imagePath, const std::filesystem::path& modelFolder, const std::filesystem::path& referencePath,
+						   const TilingConfig& tilingConfig, bool useCuda, int iterations)
+{
+	const cv::Mat image = cv::imread(imagePath.string());
+	if (image.empty())
+	{
+		printf("Couldn't read '%s'\n", imagePath.string().c_str());
+		return 1;
+	}
+
+	std::vector<std::filesystem::path> modelPaths;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(modelFolder, error))
+	{
+		if (entry.path().extension() == ".onnx") modelPaths.push_back(entry.path());
+	}
+	std::sort(modelPaths.begin(), modelPaths.end());
+	if (modelPaths.empty())
+	{
+		printf("No models found in '%s'\n", modelFolder.string().c_str());
+		return 1;
+	}
+
+	const int trackingTileSize = 32;
+	std::shared_ptr<Frame> frame = createTrackedFrame(image, trackingTileSize);
+	const cv::Rect rect = frame->region;
+
+	// Detections the other runs are measured against
+	std::vector<DetectionBox> referenceBoxes;
+	const bool hasReference = !referencePath.empty();
+	if (hasReference)
+	{
+		PreProcessBoxDetectionBase* reference = createModel(referencePath);
+		if (!reference->LoadModel(useCuda, referencePath.wstring().c_str()))
+		{
+			printf("Failed to load '%s'\n", referencePath.string().c_str());
+			delete reference;
+			return 1;
+		}
+		fitClassNumber(reference);
+		reference->InferenceOnFrame(frame, rect, referenceBoxes);
+		printf("Reference %s: %zu detections\n", referencePath.filename().string().c_str(), referenceBoxes.size());
+		delete reference;
+	}
+
+	printf("\nTiled inference on %dx%d (%s, %d iterations, overlap %.2f)\n", image.cols, image.rows, useCuda ? "CUDA" : "CPU", iterations,
+		   tilingConfig.overlap);
+	for (const auto& modelPath : modelPaths)
+	{
+		PreProcessBoxDetectionBase* model = createModel(modelPath);
+		if (!model->LoadModel(useCuda, modelPath.wstring().c_str()))
+		{
+			printf("Failed to load '%s'\n", modelPath.string().c_str());
+			delete model;
+			return 1;
+		}
+		fitClassNumber(model);
+		printf("\n%s (%s)\n", modelPath.filename().string().c_str(), model->SupportsBatching() ? "batched tiles" : "one run per tile");
+
+		TiledDetector tiledDetector;
+		tiledDetector.SetModel(model);
+		std::vector<DetectionBox> boxes;
+		std::vector<double> latencies;
+		auto printRun = [&](const char* label, int tilesRun)
+		{
+			const std::string line = std::string(label) + ":";
+			printf("%-28s %zu detections", line.c_str(), boxes.size());
+			if (tilesRun > 0) printf(", %d/%d tiles run", tilesRun, tiledDetector.GetTileCount());
+			if (hasReference) printf(", recall %.1f%%", computeRecall(boxes, referenceBoxes) * 100.0f);
+			printf("\n");
+			printPercentiles("", latencies);
+		};
+
+		// Single run on the coarsest pyramid level that fits, what the tasks do
+		latencies.clear();
+		for (int i = 0; i < iterations; ++i)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			model->InferenceOnFrame(frame, rect, boxes);
+			latencies.push_back(toMilliseconds(std::chrono::steady_clock::now() - start));
+		}
+		printRun("Full frame", 0);
+
+		// Every tile on every frame
+		TilingConfig config = tilingConfig;
+		config.selection = TILES_ALL;
+		tiledDetector.SetConfig(config);
+		latencies.clear();
+		for (int i = 0; i < iterations; ++i)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			tiledDetector.Inference(frame, rect, boxes);
+			latencies.push_back(toMilliseconds(std::chrono::steady_clock::now() - start));
+		}
+		printRun(fmtLabel("Tiled %dpx, all", config.tileSize > 0 ? config.tileSize : (int)model->GetInputShape()[3]).c_str(),
+				 tiledDetector.GetRunTileCount());
+
+		// Only the tiles under a changed corner of the frame rerun, the first frame fills every tile
+		config.selection = TILES_CHANGED;
+		tiledDetector.SetConfig(config);
+		tiledDetector.Inference(frame, rect, boxes);
+		latencies.clear();
+		int tilesRun = 0;
+		for (int i = 0; i < iterations; ++i)
+		{
+			frame->sequence = i + 1;
+			frame->tileStamps[0] = frame->sequence;
+			const auto start = std::chrono::steady_clock::now();
+			tiledDetector.Inference(frame, rect, boxes);
+			latencies.push_back(toMilliseconds(std::chrono::steady_clock::now() - start));
+			tilesRun = tiledDetector.GetRunTileCount();
+		}
+		printRun("Tiled, changed corner", tilesRun);
+		frame->sequence = 0;
+		frame->tileStamps[0] = 0;
+
+		delete model;
+	}
+	return 0;
+}
+
+// Writes a float tensor as a NumPy .npy file (version 1.0, little endian), the format the quantization script reads
+static bool writeTensor(const std::filesystem::path& path, const cv::Mat& tensor)
+{
+	std::string shape;
+	for (int i = 0; i < tensor.dims; ++i)
+	{
+		shape += std::to_string(tensor.size[i]) + (tensor.dims == 1 || i + 1 < tensor.dims ? ", " : "");
+	}
+	std::string header = "{'descr': '<f4', 'fortran_order': False, 'shape': (" + shape + "), }";
+
+	// Magic, version and header length take 10 bytes, the header is padded so the data starts 64 byte aligned
+	header.append(63 - (10 + header.size()) % 64, ' ');
+	header += '\n';
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) return false;
+	const uint16_t headerLength = (uint16_t)header.size();
+	file.write("\x93NUMPY\x01\x00", 8);
+	file.write(reinterpret_cast<const char*>(&headerLength), sizeof(headerLength));
+	file.write(header.data(), header.size());
+	file.write(reinterpret_cast<const char*>(tensor.ptr<float>()), tensor.total() * sizeof(float));
+	return file.good();
+}
+
+// Images of a folder (screenshots exported by the bot), or frames spread over a recorded session
+static bool loadFrames(const std::filesystem::path& inputPath, int frameCount, std::vector<cv::Mat>& frames, std::vector<std::filesystem::path>* imagePaths = nullptr)
+{
+	std::error_code error;
+	if (std::filesystem::is_directory(inputPath, error))
+	{
+		std::vector<std::filesystem::path> paths;
+		for (const auto& entry : std::filesystem::directory_iterator(inputPath, error))
+		{
+			const std::string extension = entry.path().extension().string();
+			if (extension == ".png" || extension == ".jpg") paths.push_back(entry.path());
+		}
+		std::sort(paths.begin(), paths.end());
+
+		const size_t stride = std::max<size_t>(1, paths.size() / std::max(1, frameCount));
+		for (size_t i = 0; i < paths.size() && (int)frames.size() < frameCount; i += stride)
+		{
+			cv::Mat image = cv::imread(paths[i].string());
+			if (image.empty()) continue;
+			frames.push_back(image);
+			if (imagePaths != nullptr) imagePaths->push_back(paths[i]);
+		}
+		return !frames.empty();
+	}
+
+	MappedReplayFrameSource source(inputPath, REPLAY_AS_FAST_AS_POSSIBLE);
+	if (!source.Open()) return false;
+	const size_t stride = std::max<size_t>(1, source.GetFrameCount() / std::max(1, frameCount));
+	cv::Mat frame;
+	for (size_t i = 0; source.Capture(frame, source.GetCaptureRect()) && (int)frames.size() < frameCount; ++i)
+	{
+		if (i % stride != 0) continue;
+		cv::Mat image;
+		if (frame.channels() == 4) cv::cvtColor(frame, image, cv::COLOR_BGRA2BGR);
+		else image = frame.clone();
+		frames.push_back(image);
+	}
+	source.Close();
+	return !frames.empty();
+}
+
+// Runs the frames through the model's own preprocessing and writes the input tensors for static quantization
+static int exportCalibration(const std::filesystem::path& modelPath, const std::filesystem::path& inputPath, const std::filesystem::path& outputFolder,
+							 int frameCount)
+{
+	std::vector<cv::Mat> frames;
+	if (!loadFrames(inputPath, frameCount, frames))
+	{
+		printf("No frames read from '%s'\n", inputPath.string().c_str());
+		return 1;
+	}
+
+	PreProcessBoxDetectionBase* model = createModel(modelPath);
+	if (!model->LoadModel(false, modelPath.wstring().c_str()))
+	{
+		printf("Failed to load '%s'\n", modelPath.string().c_str());
+		delete model;
+		return 1;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(outputFolder, error);
+	int written = 0;
+	cv::Mat tensor;
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		if (!model->PrepareInput(frames[i], tensor)) continue;
+		if (writeTensor(outputFolder / fmtLabel("calibration_%04d.npy", (int)i), tensor)) ++written;
+	}
+	delete model;
+
+	printf("Wrote %d calibration tensors for %s to '%s'\n", written, modelPath.filename().string().c_str(), outputFolder.string().c_str());
+	printf("Quantize with: python scripts/quantize.py %s %s\n", modelPath.string().c_str(), outputFolder.string().c_str());
+	return written > 0 ? 0 : 1;
+}
+
+// Boxes of a label file exported next to a screenshot (class, then center and size normalized to the image)
+static std::vector<DetectionBox> loadLabels(const std::filesystem::path& labelPath, const cv::Size& imageSize)
+{
+	std::vector<DetectionBox> labels;
+	std::ifstream file(labelPath);
+	DetectionBox box;
+	while (file >> box.classId >> box.x >> box.y >> box.w >> box.h)
+	{
+		box.w *= imageSize.width;
+		box.h *= imageSize.height;
+		box.x = box.x * imageSize.width - box.w / 2.0f;
+		box.y = box.y * imageSize.height - box.h / 2.0f;
+		box.confidence = 1.0f;
+		labels.push_back(box);
+	}
+	return labels;
+}
+
+static float computeIoU(const DetectionBox& a, const DetectionBox& b)
+{
+	const float dx = std::min(a.x + a.w, b.x + b.w) - std::max(a.x, b.x);
+	const float dy = std::min(a.y + a.h, b.y + b.h) - std::max(a.y, b.y);
+	if (dx <= 0.0f || dy <= 0.0f) return 0.0f;
+	const float intersection = dx * dy;
+	return intersection / (a.w * a.h + b.w * b.h - intersection);
+}
+
+// COCO style average precision (101 point interpolation) of every labeled class at an IoU threshold, averaged over classes
+static float computeMeanAveragePrecision(const std::vector<std::vector<DetectionBox>>& detections, const std::vector<std::vector<DetectionBox>>& labels,
+										 float iouThreshold)
+{
+	int classCount = 0;
+	for (const auto& imageLabels : labels)
+	{
+		for (const auto& label : imageLabels) classCount = std::max(classCount, label.classId + 1);
+	}
+
+	float apSum = 0.0f;
+	int labeledClasses = 0;
+	for (int classId = 0; classId < classCount; ++classId)
+	{
+		int labelCount = 0;
+		std::vector<std::vector<uint8_t>> matched(labels.size());
+		for (size_t image = 0; image < labels.size(); ++image)
+		{
+			matched[image].assign(labels[image].size(), 0);
+			for (const auto& label : labels[image]) labelCount += label.classId == classId;
+		}
+		if (labelCount == 0) continue;
+
+		// Every detection of the class, best scored first
+		std::vector<std::pair<float, std::pair<int, int>>> ranked;
+		for (size_t image = 0; image < detections.size(); ++image)
+		{
+			for (size_t i = 0; i < detections[image].size(); ++i)
+			{
+				if (detections[image][i].classId == classId) ranked.push_back({ detections[image][i].confidence, { (int)image, (int)i } });
+			}
+		}
+		std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+		// Each detection claims the best overlapping label still unmatched
+		std::vector<float> precisions, recalls;
+		int truePositives = 0;
+		for (size_t rank = 0; rank < ranked.size(); ++rank)
+		{
+			const int image = ranked[rank].second.first;
+			const DetectionBox& detection = detections[image][ranked[rank].second.second];
+			int bestLabel = -1;
+			float bestIoU = iouThreshold;
+			for (size_t l = 0; l < labels[image].size(); ++l)
+			{
+				if (labels[image][l].classId != classId || matched[image][l]) continue;
+				const float iou = computeIoU(detection, labels[image][l]);
+				if (iou >= bestIoU)
+				{
+					bestIoU = iou;
+					bestLabel = (int)l;
+				}
+			}
+			if (bestLabel >= 0)
+			{
+				matched[image][bestLabel] = 1;
+				++truePositives;
+			}
+			precisions.push_back((float)truePositives / (rank + 1));
+			recalls.push_back((float)truePositives / labelCount);
+		}
+
+		// Precision envelope, sampled at 101 recall points
+		for (int i = (int)precisions.size() - 2; i >= 0; --i) precisions[i] = std::max(precisions[i], precisions[i + 1]);
+		float ap = 0.0f;
+		size_t index = 0;
+		for (int point = 0; point <= 100; ++point)
+		{
+			const float recall = point / 100.0f;
+			while (index < recalls.size() && recalls[index] < recall) ++index;
+			if (index < recalls.size()) ap += precisions[index];
+		}
+		apSum += ap / 101.0f;
+		++labeledClasses;
+	}
+	return labeledClasses > 0 ? apSum / labeledClasses : 0.0f;
+}
+
+// mAP and latency of every model on a labeled screenshot set, the first model being the baseline (e.g. FP32 against its INT8 variant)
+static int evaluateModels(const std::filesystem::path& labeledFolder, const std::vector<std::filesystem::path>& modelPaths, bool useCuda)
+{
+	std::vector<cv::Mat> images;
+	std::vector<std::filesystem::path> imagePaths;
+	if (!loadFrames(labeledFolder, std::numeric_limits<int>::max(), images, &imagePaths))
+	{
+		printf("No screenshots found in '%s'\n", labeledFolder.string().c_str());
+		return 1;
+	}
+
+	std::vector<std::vector<DetectionBox>> labels;
+	size_t labelCount = 0;
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		labels.push_back(loadLabels(std::filesystem::path(imagePaths[i]).replace_extension(".txt"), images[i].size()));
+		labelCount += labels.back().size();
+	}
+	printf("Evaluating on %zu screenshots, %zu labels (%s)\n", images.size(), labelCount, useCuda ? "CUDA" : "CPU");
+
+	// Validation style settings, every box down to a very low score, and NMS instead of the tasks' merging
+	PostProcessConfig postProcessConfig;
+	postProcessConfig.mode = POSTPROCESS_NMS;
+	postProcessConfig.overlapThreshold = 0.7f;
+	DetectionPostProcessor postProcessor;
+	postProcessor.SetConfig(postProcessConfig);
+
+	float baselineMap50 = 0.0f, baselineMap = 0.0f;
+	double baselineLatency = 0.0;
+	for (size_t m = 0; m < modelPaths.size(); ++m)
+	{
+		const std::filesystem::path& modelPath = modelPaths[m];
+		PreProcessBoxDetectionBase* model = createModel(modelPath);
+		if (!model->LoadModel(useCuda, modelPath.wstring().c_str()))
+		{
+			printf("Failed to load '%s'\n", modelPath.string().c_str());
+			delete model;
+			return 1;
+		}
+		fitClassNumber(model);
+		model->SetConfidenceThreshold(0.001f);
+
+		// Warm up on the first screenshot, then every screenshot is timed
+		std::vector<std::vector<DetectionBox>> detections(images.size());
+		std::vector<double> latencies;
+		model->Inference(images[0], detections[0]);
+		for (size_t i = 0; i < images.size(); ++i)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			model->Inference(images[i], detections[i]);
+			latencies.push_back(toMilliseconds(std::chrono::steady_clock::now() - start));
+			postProcessor.Process(detections[i]);
+		}
+		delete model;
+
+		const float map50 = computeMeanAveragePrecision(detections, labels, 0.5f);
+		float map = 0.0f;
+		for (int t = 0; t < 10; ++t) map += computeMeanAveragePrecision(detections, labels, 0.5f + t * 0.05f) / 10.0f;
+		const double latency = percentile(latencies, 0.5);
+
+		printf("\n%s\n", modelPath.filename().string().c_str());
+		if (m == 0)
+		{
+			baselineMap50 = map50;
+			baselineMap = map;
+			baselineLatency = latency;
+			printf("%-28s %.4f | mAP50-95 %.4f\n", "mAP50:", map50, map);
+		}
+		else
+		{
+			printf("%-28s %.4f (%+.4f) | mAP50-95 %.4f (%+.4f)\n", "mAP50:", map50, map50 - baselineMap50, map, map - baselineMap);
+			printf("%-28s %.2fx the baseline\n", "Speedup:", baselineLatency / latency);
+		}
+		printPercentiles("Inference:", latencies);
+	}
+	return 0;
+}
+
+static int tuneModels(const std::filesystem::path& sessionPath, const std::filesystem::path& modelFolder, int frameCount, int iterations)
+{
+	std::vector<std::filesystem::path> modelPaths;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(modelFolder, error))
+	{
+		if (entry.path().extension() == ".onnx") modelPaths.push_back(entry.path());
+	}
+	std::sort(modelPaths.begin(), modelPaths.end());
+	if (modelPaths.empty())
+	{
+		printf("No models found in '%s'\n", modelFolder.string().c_str());
+		return 1;
+	}
+
+	// Frames spread over the whole recording
+	std::vector<cv::Mat> frames;
+	if (!loadFrames(sessionPath, frameCount, frames))
+	{
+		printf("No frames read from '%s'\n", sessionPath.string().c_str());
+		return 1;
+	}
+	printf("Tuning on %zu frames of %s (%s)\n", frames.size(), sessionPath.filename().string().c_str(), ExecutionProfileStore::GetMachineKey().c_str());
+
+	ExecutionProfileStore& store = ExecutionProfileStore::GetInstance();
+	for (const auto& modelPath : modelPaths)
+	{
+		printf("\n%s\n", modelPath.filename().string().c_str());
+		ExecutionTuner tuner([&]() { return createModel(modelPath); }, iterations);
+		ExecutionProfile profile;
+		if (!tuner.Tune(modelPath, frames, profile))
+		{
+			printf("Failed to tune '%s'\n", modelPath.string().c_str());
+			return 1;
+		}
+
+		const double baseline = tuner.GetMeasuredProfiles().front().tunedLatency;
+		printf("Fastest: %.3f ms (%.2fx the global pools)  %s\n", profile.tunedLatency, baseline / profile.tunedLatency, profile.ToString().c_str());
+		store.Set(modelPath, false, profile);
+	}
+
+	if (!store.Save())
+	{
+		printf("Failed to save the execution profiles\n");
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 3 && std::string(argv[1]) == "--capture")
+	{
+		double seconds = 5.0;
+		uint32_t rate = 60;
+		uint32_t fullFrameRate = 1;
+		std::vector<cv::Rect> regions;
+		for (int i = 3; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			cv::Rect region;
+			if (arg == "--seconds" && i + 1 < argc) seconds = std::max(0.1, std::atof(argv[++i]));
+			else if (arg == "--rate" && i + 1 < argc) rate = (uint32_t)std::max(0, std::atoi(argv[++i]));
+			else if (arg == "--full-rate" && i + 1 < argc) fullFrameRate = (uint32_t)std::max(1, std::atoi(argv[++i]));
+			else if (arg == "--roi" && i + 1 < argc && std::sscanf(argv[++i], "%d,%d,%d,%d", &region.x, &region.y, &region.width, &region.height) == 4)
+			{
+				regions.push_back(region);
+			}
+			else
+			{
+				printf("Unknown argument '%s'\n", arg.c_str());
+				return 1;
+			}
+		}
+		return benchmarkCapture(argv[2], seconds, rate, regions, fullFrameRate);
+	}
+
+	if (argc >= 2 && std::string(argv[1]) == "--bitmap-copy")
+	{
+		int iterations = 20;
+		for (int i = 2; i < argc; ++i)
+		{
+			if (std::string(argv[i]) == "--iterations" && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+		}
+		return benchmarkBitmapCopy(iterations);
+	}
+
+	if (argc >= 2 && std::string(argv[1]) == "--frame-pool")
+	{
+		int frameCount = 300;
+		for (int i = 2; i < argc; ++i)
+		{
+			if (std::string(argv[i]) == "--frames" && i + 1 < argc) frameCount = std::max(1, std::atoi(argv[++i]));
+		}
+		return checkFramePool(frameCount);
+	}
+
+	if (argc >= 4 && std::string(argv[1]) == "--calibrate")
+	{
+		std::filesystem::path modelPath = argv[2];
+		std::filesystem::path inputPath = argv[3];
+		std::filesystem::path outputFolder = "calibration/" + modelPath.stem().string();
+		int frameCount = 200;
+		for (int i = 4; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--frames" && i + 1 < argc) frameCount = std::max(1, std::atoi(argv[++i]));
+			else outputFolder = arg;
+		}
+		return exportCalibration(modelPath, inputPath, outputFolder, frameCount);
+	}
+
+	if (argc >= 4 && std::string(argv[1]) == "--evaluate")
+	{
+		std::filesystem::path labeledFolder = argv[2];
+		std::vector<std::filesystem::path> modelPaths;
+		bool useCuda = true;
+		for (int i = 3; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--cpu") useCuda = false;
+			else modelPaths.push_back(arg);
+		}
+		return evaluateModels(labeledFolder, modelPaths, useCuda);
+	}
+
+	if (argc >= 3 && std::string(argv[1]) == "--tune")
+	{
+		std::filesystem::path sessionPath = argv[2];
+		std::filesystem::path modelFolder = "models";
+		int frameCount = 16;
+		int iterations = 50;
+		for (int i = 3; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--frames" && i + 1 < argc) frameCount = std::max(1, std::atoi(argv[++i]));
+			else if (arg == "--iterations" && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+			else modelFolder = arg;
+		}
+		return tuneModels(sessionPath, modelFolder, frameCount, iterations);
+	}
+
+	if (argc >= 3 && std::string(argv[1]) == "--tiles")
+	{
+		std::filesystem::path imagePath = argv[2];
+		std::filesystem::path modelFolder = "models";
+		std::filesystem::path referencePath;
+		TilingConfig tilingConfig;
+		bool useCuda = true;
+		int iterations = 20;
+		for (int i = 3; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--cpu") useCuda = false;
+			else if (arg == "--reference" && i + 1 < argc) referencePath = argv[++i];
+			else if (arg == "--tile-size" && i + 1 < argc) tilingConfig.tileSize = std::max(0, std::atoi(argv[++i]));
+			else if (arg == "--overlap" && i + 1 < argc) tilingConfig.overlap = (float)std::atof(argv[++i]);
+			else if (arg == "--iterations" && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+			else modelFolder = arg;
+		}
+		return benchmarkTiling(imagePath, modelFolder, referencePath, tilingConfig, useCuda, iterations);
+	}
+
+	if (argc >= 2 && std::string(argv[1]) == "--decoders")
+	{
+		std::filesystem::path modelFolder = "models";
+		std::filesystem::path imagePath;
+		bool useCuda = true;
+		int iterations = 1000;
+		for (int i = 2; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--cpu") useCuda = false;
+			else if (arg == "--image" && i + 1 < argc) imagePath = argv[++i];
+			else if (arg == "--iterations" && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+			else modelFolder = arg;
+		}
+		return benchmarkDecoders(modelFolder, imagePath, useCuda, iterations);
+	}
+
+	if (argc >= 2 && std::string(argv[1]) == "--models")
+	{
+		std::filesystem::path modelFolder = "models";
+		bool useCuda = true;
+		int iterations = 50;
+		for (int i = 2; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--cpu") useCuda = false;
+			else if (arg == "--iterations" && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+			else modelFolder = arg;
+		}
+		return benchmarkModels(modelFolder, useCuda, iterations);
+	}
+
+	if (argc < 2)
+	{
+		printf("Usage: %s <session.osrsrec> [--stepped|--fast|--realtime] [--format bgr|bgra] [--letterbox] [--no-gating] [--no-tracking] [--tiled] [--cpu] [--tab-model <path>] [--inventory-model <path>]\n",
+			   argv[0]);
+		printf("       %s --capture <x11[:display]|image|image folder|session.osrsrec> [--seconds <count>] [--rate <Hz>]\n"
+			   "                    [--roi <x,y,w,h> ...] [--full-rate <Hz>]\n", argv[0]);
+		printf("       %s --bitmap-copy [--iterations <count>]\n", argv[0]);
+		printf("       %s --frame-pool [--frames <count>]\n", argv[0]);
+		printf("       %s --models [model folder] [--cpu] [--iterations <count>]\n", argv[0]);
+		printf("       %s --decoders [model folder] [--image <screenshot>] [--cpu] [--iterations <count>]\n", argv[0]);
+		printf("       %s --calibrate <model> <session.osrsrec|screenshot folder> [output folder] [--frames <count>]\n", argv[0]);
+		printf("       %s --evaluate <labeled screenshot folder> <model> [<model> ...] [--cpu]\n", argv[0]);
+		printf("       %s --tune <session.osrsrec> [model folder] [--frames <count>] [--iterations <count>]\n", argv[0]);
+		printf("       %s --tiles <screenshot> [model folder] [--reference <model>] [--tile-size <pixels>] [--overlap <fraction>] [--cpu] [--iterations <count>]\n",
+			   argv[0]);
+		return 1;
+	}
+
+	std::filesystem::path sessionPath = argv[1];
+	ReplayTiming timing = REPLAY_STEPPED;
+	FramePixelFormat pixelFormat = FRAME_FORMAT_BGR;
+	bool letterbox = false;
+	bool motionGating = true;
+	bool templateTracking = true;
+	bool tiledInference = false;
+	bool useCuda = true;
+	std::filesystem::path tabModelPath, inventoryModelPath;
+	for (int i = 2; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--stepped") timing = REPLAY_STEPPED;
+		else if (arg == "--fast") timing = REPLAY_AS_FAST_AS_POSSIBLE;
+		else if (arg == "--realtime") timing = REPLAY_RECORDED_TIMING;
+		else if (arg == "--format" && i + 1 < argc) pixelFormat = std::string(argv[++i]) == "bgra" ? FRAME_FORMAT_BGRA : FRAME_FORMAT_BGR;
+		else if (arg == "--letterbox") letterbox = true;
+		else if (arg == "--no-gating") motionGating = false;
+		else if (arg == "--no-tracking") templateTracking = false;
+		else if (arg == "--tiled") tiledInference = true;
+		else if (arg == "--cpu") useCuda = false;
+		else if (arg == "--tab-model" && i + 1 < argc) tabModelPath = argv[++i];
+		else if (arg == "--inventory-model" && i + 1 < argc) inventoryModelPath = argv[++i];
+		else
+		{
+			printf("Unknown argument '%s'\n", arg.c_str());
+			return 1;
+		}
+	}
+
+	// The capture service owns the source, we only keep it around to step and poll it
+	MappedReplayFrameSource* source = new MappedReplayFrameSource(sessionPath, timing);
+	const size_t frameCount = source->GetFrameCount();
+	if (frameCount == 0)
+	{
+		printf("No frames to replay in '%s'\n", sessionPath.string().c_str());
+		delete source;
+		return 1;
+	}
+
+	WindowCaptureService& captureService = WindowCaptureService::GetInstance();
+	captureService.SetCaptureRate(0);
+	captureService.SetFullFrameRate(0);
+	captureService.SetPixelFormat(pixelFormat);
+	captureService.StartCapture(source);
+
+	// Tasks warm up on the first frame (not part of the measurements)
+	if (timing == REPLAY_STEPPED) source->Step();
+	FrameHandle frameHandle = captureService.WaitForFrameNewerThan(0, std::chrono::seconds(5));
+	if (frameHandle->sequence == 0)
+	{
+		printf("Replay didn't produce any frame\n");
+		captureService.StopCapture();
+		return 1;
+	}
+
+	FindTabTask* findTabTask = new FindTabTask();
+	InventoryDropTask* inventoryDropTask = new InventoryDropTask();
+	if (!tabModelPath.empty()) findTabTask->SetModelPath(tabModelPath.wstring());
+	if (!inventoryModelPath.empty()) inventoryDropTask->SetModelPath(inventoryModelPath.wstring());
+	findTabTask->SetNextTask(inventoryDropTask);
+
+	// Measurements cover the inference itself, so the tasks run it inline (and every stepped frame gets its detections)
+	findTabTask->SetAsyncInference(false);
+	inventoryDropTask->SetAsyncInference(false);
+	// Headless, there's no window system to show the tab on
+	inventoryDropTask->SetShowTabWindow(false);
+	findTabTask->SetTemplateTracking(templateTracking);
+	findTabTask->SetTiling(tiledInference);
+	findTabTask->SetUseCuda(useCuda);
+	inventoryDropTask->SetUseCuda(useCuda);
+	std::vector<IBotTask*> tasks = { findTabTask, inventoryDropTask };
+
+	bool loaded = true;
+	for (auto task : tasks)
+	{
+		loaded &= task->Load();
+	}
+
+	// Same per frame flow as the BotManagerWindow
+	ResourceManager& resourceManager = ResourceManager::GetInstance();
+	TaskScheduler taskScheduler;
+	taskScheduler.SetMotionGating(motionGating);
+	cv::Mat frame;
+	auto runTasks = [&](float deltaTime)
+	{
+		resourceManager.RemoveAllResources();
+		frame = frameHandle->image.clone();
+		resourceManager.SetResource("Main Frame", &frame);
+		resourceManager.SetResource("Main Frame Handle", &frameHandle);
+		taskScheduler.Run(tasks, deltaTime);
+	};
+	if (loaded) runTasks(0.0f);
+	taskScheduler.ResetStats();
+
+	// Standalone preprocessing of every frame into a typical model input, comparing
+	// the fused kernel against the OpenCV passes (and pixel formats across runs)
+	const cv::Size preprocessSize(640, 640);
+	ImagePreProcessor fusedPreProcessor, openCVPreProcessor;
+	fusedPreProcessor.SetMode(PREPROCESS_FUSED);
+	fusedPreProcessor.SetLetterbox(letterbox);
+	openCVPreProcessor.SetMode(PREPROCESS_OPENCV);
+	openCVPreProcessor.SetLetterbox(letterbox);
+
+	std::vector<double> captureTimes, fusedTimes, openCVTimes, taskTimes, latencies;
+	captureTimes.reserve(frameCount);
+	fusedTimes.reserve(frameCount);
+	openCVTimes.reserve(frameCount);
+	taskTimes.reserve(frameCount);
+	latencies.reserve(frameCount);
+	uint64_t skippedFrames = 0;
+	uint64_t taskAllocations = 0;
+	const auto runStart = std::chrono::steady_clock::now();
+	while (loaded)
+	{
+		const FrameHandle previousFrame = frameHandle;
+		if (timing == REPLAY_STEPPED)
+		{
+			if (source->IsFinished()) break;
+			source->Step();
+		}
+
+		frameHandle = captureService.WaitForFrameNewerThan(previousFrame->sequence, std::chrono::seconds(1));
+		if (frameHandle->sequence == previousFrame->sequence)
+		{
+			if (source->IsFinished()) break;
+			continue;
+		}
+		skippedFrames += frameHandle->sequence - previousFrame->sequence - 1;
+		captureTimes.push_back(toMilliseconds(frameHandle->publishTime - frameHandle->captureTime));
+
+		const auto fusedStart = std::chrono::steady_clock::now();
+		fusedPreProcessor.Process(frameHandle->image, preprocessSize);
+		const auto openCVStart = std::chrono::steady_clock::now();
+		openCVPreProcessor.Process(frameHandle->image, preprocessSize);
+		fusedTimes.push_back(toMilliseconds(openCVStart - fusedStart));
+		openCVTimes.push_back(toMilliseconds(std::chrono::steady_clock::now() - openCVStart));
+
+		const uint64_t allocationsBefore = allocationCount;
+		const auto taskStart = std::chrono::steady_clock::now();
+		runTasks(std::chrono::duration<float>(frameHandle->captureTime - previousFrame->captureTime).count());
+		const auto taskEnd = std::chrono::steady_clock::now();
+		taskAllocations += allocationCount - allocationsBefore;
+
+		taskTimes.push_back(toMilliseconds(taskEnd - taskStart));
+		latencies.push_back(toMilliseconds(taskEnd - frameHandle->captureTime));
+	}
+	const double runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+	std::vector<std::pair<std::string, TaskRunStats>> taskStats;
+	for (auto task : tasks)
+	{
+		taskStats.emplace_back(task->GetName(), taskScheduler.GetStats(task));
+	}
+	const TaskRunStats totalStats = taskScheduler.GetTotalStats();
+	const size_t trackedCount = findTabTask->GetTrackedCount();
+	const size_t detectionCount = findTabTask->GetDetectionCount();
+
+	// Tasks go first, they hold region subscriptions on the capture service
+	for (auto task : tasks)
+	{
+		delete task;
+	}
+	frameHandle = nullptr;
+	captureService.StopCapture();
+
+	if (!loaded)
+	{
+		printf("Failed to load the task chain\n");
+		return 1;
+	}
+
+	printf("\nReplayed '%s' (%zu recorded frames) as %s\n", sessionPath.string().c_str(), frameCount, pixelFormat == FRAME_FORMAT_BGRA ? "BGRA" : "BGR");
+	printf("Processed %zu frames in %.3f s (%.2f frames/s), %llu skipped\n", taskTimes.size(), runSeconds, taskTimes.size() / std::max(runSeconds, 1e-9),
+		   static_cast<unsigned long long>(skippedFrames));
+	printPercentiles("Capture:", captureTimes);
+	printPercentiles("Preprocess fused:", fusedTimes);
+	printPercentiles("Preprocess OpenCV:", openCVTimes);
+	printPercentiles("Task chain:", taskTimes);
+	printPercentiles("Capture to decision latency:", latencies);
+	printf("Heap allocations per frame (whole task chain and capture thread, see --models for inference alone): %.2f\n", taskTimes.empty() ? 0.0 : (double)taskAllocations / taskTimes.size());
+
+	printf("\nMotion gating %s\n", motionGating ? "on" : "off");
+	for (const auto& [name, stats] : taskStats)
+	{
+		printf("%-24s %6zu ran, %6zu skipped (%5.1f%%), %8.3f ms/run, %10.3f ms saved\n", (name + ":").c_str(), stats.executedCount, stats.skippedCount,
+			   stats.GetSkipRatio() * 100.0f, stats.GetAverageRunTime(), stats.GetSavedTime());
+	}
+	printf("%-24s %6zu ran, %6zu skipped (%5.1f%%), %21s %10.3f ms saved\n", "Total:", totalStats.executedCount, totalStats.skippedCount,
+		   totalStats.GetSkipRatio() * 100.0f, "", totalStats.GetSavedTime());
+	printf("Tab tracking %s: %zu frames verified against templates, %zu model detections\n", templateTracking ? "on" : "off", trackedCount, detectionCount);
+	return 0;
+}
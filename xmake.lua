@@ -27,6 +27,15 @@ target("osrs-bot")
 	add_headerfiles("src/**.h", "include/**.h")
 
     add_files("src/**.cpp")
+	remove_files("src/tools/**.cpp")
+
+	-- Platform specific frame sources
+	if is_plat("windows") then
+		remove_files("src/system/frameSources/x11FrameSource.cpp")
+	else
+		remove_files("src/system/frameSources/gdiFrameSource.cpp", "src/windowPicker.cpp")
+		add_syslinks("X11", "Xext")
+	end
 
 	set_languages("c++20")
 
@@ -106,4 +115,36 @@ target("osrs-bot")
 			os.cp("rsc/icon.png", target:targetdir())
 		end
     end)
+target_end()
+
+-- Headless benchmark replaying recorded sessions through the task chain
+target("replay-runner")
+	set_kind("binary")
+
+	add_packages("imgui", "glad", "fmt", "nativefiledialog-extended")
+	add_packages("onnxruntime", "opencv", "nlohmann_json")
+
+	add_includedirs("src", "include")
+
+	add_files("src/tools/replayRunner.cpp")
+	add_files("src/bot/taskScheduler.cpp", "src/bot/tasks/*.cpp", "src/ml/*.cpp")
+	add_files("src/system/framePool.cpp", "src/system/tileChangeTracker.cpp", "src/system/windowCaptureService.cpp", "src/system/mappedFile.cpp")
+	add_files("src/system/frameSources/mappedReplayFrameSource.cpp", "src/system/frameSources/replayFrameSource.cpp")
+	add_files("src/system/frameSources/bitmapFrameSource.cpp")
+
+	-- Live capture (off Windows, e.g. against Xvfb)
+	if not is_plat("windows") then
+		add_files("src/system/frameSources/x11FrameSource.cpp")
+		add_syslinks("X11", "Xext")
+	end
+
+	set_languages("c++20")
+
+	if is_mode("debug") then
+		add_defines("DEBUG_BUILD");
+		set_targetdir("bin/Debug/")
+	elseif is_mode("release") or is_mode("releasedbg") then
+		add_defines("RELEASE_BUILD");
+		set_targetdir("bin/Release/")
+	end
 target_end()
\ No newline at end of file